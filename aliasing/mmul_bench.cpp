@@ -0,0 +1,95 @@
+// This program benchmarks CPU versions of the aliasing matrixMul kernels
+// (restrict, local accumulator and naive), a multiversioned kernel that
+// checks for overlap at runtime before using a vectorized restrict i-k-j
+// body, and the same i-k-j loop without restrict (interchange)
+// Build: g++ -O3 -march=native mmul_bench.cpp mmul_kernels.cpp
+//        -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+#include "../common/verify.h"
+
+// Function prototypes
+void mmul_restrict(const int *__restrict a, const int *__restrict b,
+                   int *__restrict c, int N);
+void mmul_local(const int *a, const int *b, int *c, int N);
+void mmul_naive(const int *a, const int *b, int *c, int N);
+void mmul_multiversioned(const int *a, const int *b, int *c, int N);
+void mmul_interchange(const int *a, const int *b, int *c, int N);
+
+// Run one of the kernels on random N x N matrices (a, b and c don't
+// overlap)
+static void mmulBench(benchmark::State &s,
+                      void (*mmul)(const int *, const int *, int *, int)) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // Allocate and initialize our matrices
+  std::vector<int> a(N * N);
+  std::vector<int> b(N * N);
+  std::vector<int> c(N * N);
+  for (int i = 0; i < N * N; i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Check the result before timing anything
+  mmul(a.data(), b.data(), c.data(), N);
+  if (!verify_mmul(a.data(), b.data(), c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul(a.data(), b.data(), c.data(), N);
+    benchmark::ClobberMemory();
+  }
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+BENCHMARK_CAPTURE(mmulBench, restrict, mmul_restrict)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mmulBench, local, mmul_local)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mmulBench, naive, mmul_naive)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mmulBench, multiversioned, mmul_multiversioned)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mmulBench, interchange, mmul_interchange)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+// The multiversioned kernel when c overlaps a, so the overlap check sends
+// it down the naive path (compare with mmulBench/naive for the check's
+// cost)
+static void overlapBench(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // c starts half way through a
+  std::vector<int> buffer(N * N + N * N / 2);
+  std::vector<int> b(N * N);
+  for (auto &x : buffer) x = rand() % 100;
+  for (auto &x : b) x = rand() % 100;
+  int *a = buffer.data();
+  int *c = buffer.data() + N * N / 2;
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul_multiversioned(a, b.data(), c, N);
+    benchmark::ClobberMemory();
+  }
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+BENCHMARK(overlapBench)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+// CPU versions of the matrixMul kernels from matrixMul.cu (restrict),
+// matrixMul_alt.cu (local accumulator) and matrixMul_naive.cu, plus a
+// multiversioned kernel that checks for overlap at runtime and an
+// interchanged (i-k-j) kernel without restrict. Each one sets c = a * b for
+// N x N row-major matrices. They live in their own translation unit so the
+// compiler can't see what the caller passes in.
+// By: Nick from CoffeeBeforeArch
+
+#include <cstddef>
+#include <cstdint>
+
+// Like matrixMul.cu: the compiler may assume c doesn't alias a or b, so
+// c[i * N + j] can stay in a register for the whole k loop
+void mmul_restrict(const int *__restrict a, const int *__restrict b,
+                   int *__restrict c, int N) {
+  // For every row...
+  for (int i = 0; i < N; i++) {
+    // For every column...
+    for (int j = 0; j < N; j++) {
+      // Iterate over row, and down column
+      c[i * N + j] = 0;
+      for (int k = 0; k < N; k++) {
+        // Accumulate results for a single element
+        c[i * N + j] += a[i * N + k] * b[k * N + j];
+      }
+    }
+  }
+}
+
+// Like matrixMul_alt.cu: no restrict, but we accumulate in a local and
+// only write c once
+void mmul_local(const int *a, const int *b, int *c, int N) {
+  // For every row...
+  for (int i = 0; i < N; i++) {
+    // For every column...
+    for (int j = 0; j < N; j++) {
+      // Iterate over row, and down column
+      int tmp = 0;
+      for (int k = 0; k < N; k++) {
+        // Accumulate results for a single element
+        tmp += a[i * N + k] * b[k * N + j];
+      }
+
+      // Write back the result
+      c[i * N + j] = tmp;
+    }
+  }
+}
+
+// Like matrixMul_naive.cu: every store to c might change a or b, so c is
+// reloaded and stored on every iteration of k
+void mmul_naive(const int *a, const int *b, int *c, int N) {
+  // For every row...
+  for (int i = 0; i < N; i++) {
+    // For every column...
+    for (int j = 0; j < N; j++) {
+      // Iterate over row, and down column
+      c[i * N + j] = 0;
+      for (int k = 0; k < N; k++) {
+        // Accumulate results for a single element
+        c[i * N + j] += a[i * N + k] * b[k * N + j];
+      }
+    }
+  }
+}
+
+// Not one of the CUDA kernels: i-k-j order, so the inner loop runs along
+// rows of b and c and vectorizes. No restrict, so this shows what the loop
+// interchange is worth on its own (the compiler adds its own overlap check
+// for c_row and b_row).
+void mmul_interchange(const int *a, const int *b, int *c, int N) {
+  // For every row...
+  for (int i = 0; i < N; i++) {
+    int *c_row = c + static_cast<size_t>(i) * N;
+    for (int j = 0; j < N; j++) c_row[j] = 0;
+
+    // Add a[i][k] times row k of b into row i of c
+    for (int k = 0; k < N; k++) {
+      int a_ik = a[static_cast<size_t>(i) * N + k];
+      const int *b_row = b + static_cast<size_t>(k) * N;
+      for (int j = 0; j < N; j++) c_row[j] += a_ik * b_row[j];
+    }
+  }
+}
+
+// The same i-k-j loop with restrict: the no-alias body of the
+// multiversioned kernel, vectorized without any overlap checks of its own
+static void mmul_interchange_restrict(const int *__restrict a,
+                                      const int *__restrict b,
+                                      int *__restrict c, int N) {
+  // For every row...
+  for (int i = 0; i < N; i++) {
+    int *c_row = c + static_cast<size_t>(i) * N;
+    for (int j = 0; j < N; j++) c_row[j] = 0;
+
+    // Add a[i][k] times row k of b into row i of c
+    for (int k = 0; k < N; k++) {
+      int a_ik = a[static_cast<size_t>(i) * N + k];
+      const int *b_row = b + static_cast<size_t>(k) * N;
+      for (int j = 0; j < N; j++) c_row[j] += a_ik * b_row[j];
+    }
+  }
+}
+
+// Do [x, x + n) and [y, y + n) share any bytes?
+static bool overlaps(const void *x, const void *y, size_t bytes) {
+  auto px = reinterpret_cast<uintptr_t>(x);
+  auto py = reinterpret_cast<uintptr_t>(y);
+  return px < py + bytes && py < px + bytes;
+}
+
+// Callers can't promise restrict, so check once per call: if c overlaps
+// neither a nor b (a and b are only read, so they may overlap each other)
+// run the vectorized restrict i-k-j body, otherwise keep the exact
+// semantics of the naive kernel. Compare with mmul_interchange (same loop,
+// no restrict) for the cost of the check, and with mmul_naive for the
+// vectorization gain.
+void mmul_multiversioned(const int *a, const int *b, int *c, int N) {
+  size_t bytes = static_cast<size_t>(N) * N * sizeof(int);
+  if (!overlaps(c, a, bytes) && !overlaps(c, b, bytes)) {
+    mmul_interchange_restrict(a, b, c, N);
+  } else {
+    mmul_naive(a, b, c, N);
+  }
+}
@@ -2,23 +2,27 @@
 // By: Nick from CoffeeBeforeArch
 
 #include <benchmark/benchmark.h>
-#include <vector>
+#include "../common/huge_pages.h"
+#include "../common/perf_counter.h"
 
-using std::vector;
-
-// Benchmark for showing cache associativity
+// Benchmark for showing cache associativity (the array is on pages of the
+// second argument's KB, so large arrays aren't just measuring page walks)
 static void LLC_Bench(benchmark::State &s) {
   // Const step size (512kB)
   const int step = 1 << 17;
 
   // Use a variable array size
   const int size = 1 << s.range(0);
-  vector<int> v(size);
+  HugeBuffer<int> v(size, size_t(s.range(1)) << 10);
 
   // Number of accesses
   const int MAX_ITER = 1 << 20;
 
+  // Count the TLB misses too (if we can)
+  auto tlb_misses = PerfCounter::dtlb_load_misses();
+
   // Profile the runtime of different step sizes
+  tlb_misses.start();
   while (s.KeepRunning()) {
     int i = 0;
     for (int iter = 0; iter < MAX_ITER; iter++) {
@@ -28,9 +32,20 @@ static void LLC_Bench(benchmark::State &s) {
       if (i >= size) i = 0;
     }
   }
+  tlb_misses.stop();
+
+  // Which pages we actually got
+  s.SetLabel(page_backing_name(v.backing()));
+  s.counters["page_KB"] = v.page_size() >> 10;
+  if (tlb_misses.valid()) {
+    s.counters["dTLB_miss_per_access"] =
+        double(tlb_misses.read()) / (double(MAX_ITER) * s.iterations());
+  }
 }
-// Register the benchmark
-BENCHMARK(LLC_Bench)->DenseRange(20, 30)->Unit(benchmark::kMillisecond);
+// Register the benchmark (4 KiB, 2 MiB and 1 GiB pages)
+BENCHMARK(LLC_Bench)
+    ->ArgsProduct({benchmark::CreateDenseRange(20, 30, 1), {4, 2048, 1 << 20}})
+    ->Unit(benchmark::kMillisecond);
 
 // Benchmark main function
 BENCHMARK_MAIN();
@@ -0,0 +1,204 @@
+// Buffers backed by huge pages, for benchmarks whose random accesses
+// spread over more memory than the TLB covers (with 4 KiB pages, a walk
+// of the page tables can cost as much as the cache miss we wanted to
+// measure).
+//
+// HugeBuffer asks for the page size we want, and falls back one step at a
+// time when the system can't give it to us:
+//   1 GiB hugetlb -> 2 MiB hugetlb -> transparent huge pages -> 4 KiB
+// hugetlb pages have to be reserved up front (vm.nr_hugepages, or
+// /sys/kernel/mm/hugepages/hugepages-*/nr_hugepages). Transparent huge
+// pages only need /sys/kernel/mm/transparent_hugepage/enabled to be
+// "madvise" or "always", but the kernel may still hand out 4 KiB pages,
+// so we look at /proc/self/smaps to see what we actually got.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+constexpr size_t page_4k = size_t(4) << 10;
+constexpr size_t page_2m = size_t(2) << 20;
+constexpr size_t page_1g = size_t(1) << 30;
+
+// Where the memory came from
+enum class PageBacking { hugetlb, transparent, normal };
+
+inline const char *page_backing_name(PageBacking b) {
+  switch (b) {
+    case PageBacking::hugetlb:
+      return "hugetlb";
+    case PageBacking::transparent:
+      return "thp";
+    case PageBacking::normal:
+      return "normal";
+  }
+  return "unknown";
+}
+
+// Bytes of [addr, addr + bytes) backed by transparent huge pages (the
+// AnonHugePages of the mappings that overlap it)
+inline size_t transparent_huge_bytes(const void *addr, size_t bytes) {
+  FILE *f = fopen("/proc/self/smaps", "r");
+  if (!f) return 0;
+  auto begin = reinterpret_cast<uintptr_t>(addr);
+  auto end = begin + bytes;
+  size_t huge = 0;
+  bool inside = false;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    unsigned long start, stop;
+    size_t kb;
+    // Mapping headers look like "start-end perms ..."
+    if (sscanf(line, "%lx-%lx ", &start, &stop) == 2) {
+      inside = start < end && stop > begin;
+    } else if (inside && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+      huge += kb << 10;
+    }
+  }
+  fclose(f);
+  return huge;
+}
+
+// Holds n elements of a trivial type (like int), zero-initialized
+template <typename T>
+class HugeBuffer {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "the memory comes straight from mmap");
+
+ public:
+  HugeBuffer() = default;
+
+  // n zeroed elements, on pages of page_bytes (4 KiB, 2 MiB or 1 GiB) or
+  // the next best thing we can get. Pages are touched up front, so the
+  // page faults don't land in whatever gets timed.
+  HugeBuffer(size_t n, size_t page_bytes) : n(n) {
+    size_t bytes = std::max<size_t>(n * sizeof(T), 1);
+    if (page_bytes >= page_1g && map_hugetlb(bytes, page_1g)) return;
+    if (page_bytes >= page_2m && map_hugetlb(bytes, page_2m)) return;
+    map_normal(bytes, page_bytes >= page_2m);
+  }
+
+  ~HugeBuffer() { release(); }
+
+  HugeBuffer(HugeBuffer &&other) noexcept { swap(other); }
+  HugeBuffer &operator=(HugeBuffer &&other) noexcept {
+    if (this != &other) {
+      release();
+      swap(other);
+    }
+    return *this;
+  }
+  HugeBuffer(const HugeBuffer &) = delete;
+  HugeBuffer &operator=(const HugeBuffer &) = delete;
+
+  T *data() { return ptr; }
+  const T *data() const { return ptr; }
+  size_t size() const { return n; }
+  T &operator[](size_t i) { return ptr[i]; }
+  const T &operator[](size_t i) const { return ptr[i]; }
+  T *begin() { return ptr; }
+  T *end() { return ptr + n; }
+
+  PageBacking backing() const { return kind; }
+
+  // Page size we actually got. Transparent huge pages count as 2 MiB if
+  // they cover most of the buffer
+  size_t page_size() const {
+    if (kind == PageBacking::hugetlb) return hugetlb_page;
+    if (kind == PageBacking::transparent &&
+        2 * huge_bytes() >= n * sizeof(T)) {
+      return page_2m;
+    }
+    return page_4k;
+  }
+
+  // Bytes on huge pages (all or nothing for hugetlb)
+  size_t huge_bytes() const {
+    if (kind == PageBacking::hugetlb) return mapped;
+    if (kind == PageBacking::transparent) {
+      return transparent_huge_bytes(ptr, mapped);
+    }
+    return 0;
+  }
+
+ private:
+  // Explicit huge pages (fails unless enough are reserved)
+  bool map_hugetlb(size_t bytes, size_t page) {
+    size_t length = (bytes + page - 1) / page * page;
+    int log2_page = __builtin_ctzll(page);
+    void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE |
+                       (log2_page << MAP_HUGE_SHIFT),
+                   -1, 0);
+    if (p == MAP_FAILED) return false;
+    ptr = static_cast<T *>(p);
+    region = p;
+    mapped = region_bytes = length;
+    kind = PageBacking::hugetlb;
+    hugetlb_page = page;
+    return true;
+  }
+
+  // Normal pages, with transparent huge pages if we asked for them
+  void map_normal(size_t bytes, bool transparent) {
+    // Transparent huge pages need 2 MiB aligned ranges, so map a little
+    // extra and start at the first aligned address inside it
+    size_t length = (bytes + page_4k - 1) / page_4k * page_4k;
+    size_t slack = transparent ? page_2m : 0;
+    void *p = mmap(nullptr, length + slack, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+    region = p;
+    region_bytes = length + slack;
+    auto address = reinterpret_cast<uintptr_t>(p);
+    if (transparent) address = (address + page_2m - 1) & ~(page_2m - 1);
+    ptr = reinterpret_cast<T *>(address);
+    mapped = length;
+
+    // Ask for (or keep away) transparent huge pages
+    kind = PageBacking::normal;
+    int advice = transparent ? MADV_HUGEPAGE : MADV_NOHUGEPAGE;
+    if (madvise(ptr, length, advice) == 0 && transparent) {
+      kind = PageBacking::transparent;
+    }
+
+    // Fault everything in now
+    auto bytes_ptr = reinterpret_cast<volatile char *>(ptr);
+    for (size_t i = 0; i < length; i += page_4k) bytes_ptr[i] = 0;
+  }
+
+  void release() {
+    if (region) munmap(region, region_bytes);
+    region = nullptr;
+  }
+
+  void swap(HugeBuffer &other) {
+    std::swap(ptr, other.ptr);
+    std::swap(n, other.n);
+    std::swap(region, other.region);
+    std::swap(region_bytes, other.region_bytes);
+    std::swap(mapped, other.mapped);
+    std::swap(kind, other.kind);
+    std::swap(hugetlb_page, other.hugetlb_page);
+  }
+
+  T *ptr = nullptr;
+  size_t n = 0;
+  void *region = nullptr;  // What we have to munmap
+  size_t region_bytes = 0;
+  size_t mapped = 0;  // Bytes usable from ptr
+  PageBacking kind = PageBacking::normal;
+  size_t hugetlb_page = 0;
+};
@@ -0,0 +1,278 @@
+// A 2D array whose memory layout is a template parameter, so the same
+// code can walk row-major, column-major, tiled or Morton (Z-order)
+// storage:
+//   - RowMajor / ColumnMajor: rows (or columns) are contiguous, so
+//     walking the other way touches a new cache line every element
+//   - Tiled<TR, TC>: TR x TC tiles stored one after another (4 x 4 ints
+//     is one cache line), rows of tiles in row-major order
+//   - Morton: the bits of i and j interleaved, so every aligned 2^k x 2^k
+//     block is contiguous at every k, and rows and columns are both walked
+//     a small block at a time. Pads to a power-of-two square.
+// Layouts map (i, j) to an offset in a few shifts and masks (or two pdep
+// instructions for Morton with BMI2). Each one also says how many
+// elements of a row are next to each other in memory (row_run, a power
+// of two: elements j..j+row_run-1 are contiguous when j is a multiple of
+// it), so kernels can switch to plain pointer loops over those runs.
+// Matrix2D adds the storage (aligned to a cache line) and row, column and
+// tile iterators.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+class RowMajor {
+ public:
+  static constexpr size_t row_run = size_t(1) << 62;
+
+  RowMajor(size_t rows, size_t cols) : num_cols(cols), n(rows * cols) {}
+  size_t size() const { return n; }
+  size_t operator()(size_t i, size_t j) const { return i * num_cols + j; }
+
+  // Distance between rows (for code that takes a leading dimension)
+  size_t stride() const { return num_cols; }
+
+ private:
+  size_t num_cols;
+  size_t n;
+};
+
+class ColumnMajor {
+ public:
+  static constexpr size_t row_run = 1;
+
+  ColumnMajor(size_t rows, size_t cols) : num_rows(rows), n(rows * cols) {}
+  size_t size() const { return n; }
+  size_t operator()(size_t i, size_t j) const { return j * num_rows + i; }
+
+ private:
+  size_t num_rows;
+  size_t n;
+};
+
+// TR x TC tiles (powers of two, so the divisions are shifts). Rows and
+// columns are padded to whole tiles.
+template <int TR = 4, int TC = 4>
+class Tiled {
+  static_assert(TR > 0 && (TR & (TR - 1)) == 0, "TR must be a power of two");
+  static_assert(TC > 0 && (TC & (TC - 1)) == 0, "TC must be a power of two");
+
+ public:
+  static constexpr int tile_rows = TR;
+  static constexpr int tile_cols = TC;
+  static constexpr size_t row_run = TC;
+
+  Tiled(size_t rows, size_t cols)
+      : tiles_per_row((cols + TC - 1) / TC),
+        n((rows + TR - 1) / TR * tiles_per_row * TR * TC) {}
+  size_t size() const { return n; }
+  size_t operator()(size_t i, size_t j) const {
+    size_t tile = (i / TR) * tiles_per_row + j / TC;
+    return tile * (TR * TC) + (i % TR) * TC + j % TC;
+  }
+
+ private:
+  size_t tiles_per_row;
+  size_t n;
+};
+
+class Morton {
+ public:
+  // (i, 2m) and (i, 2m + 1) are neighbours
+  static constexpr size_t row_run = 2;
+
+  Morton(size_t rows, size_t cols) {
+    size_t side = 1;
+    while (side < rows || side < cols) side *= 2;
+    n = side * side;
+  }
+  size_t size() const { return n; }
+
+  // i goes in the odd bits, so each 2 x 2 block is row-major
+  size_t operator()(size_t i, size_t j) const {
+    return (spread(i) << 1) | spread(j);
+  }
+
+  // Spread the low 32 bits of x out to the even bits
+  static uint64_t spread(uint64_t x) {
+#ifdef __BMI2__
+    return _pdep_u64(x, 0x5555555555555555ull);
+#else
+    x &= 0xffffffffull;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+#endif
+  }
+
+ private:
+  size_t n;
+};
+
+// Walks the elements of M (a Matrix2D, or a const one) from (i, j) in
+// steps of (di, dj)
+template <typename M>
+class MatrixLineIterator {
+ public:
+  using reference = decltype(std::declval<M &>()(0, 0));
+  using value_type = typename std::remove_reference<reference>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = value_type *;
+  using iterator_category = std::forward_iterator_tag;
+
+  MatrixLineIterator(M *m, size_t i, size_t j, size_t di, size_t dj)
+      : m(m), i(i), j(j), di(di), dj(dj) {}
+
+  reference operator*() const { return (*m)(i, j); }
+  MatrixLineIterator &operator++() {
+    i += di;
+    j += dj;
+    return *this;
+  }
+  bool operator==(const MatrixLineIterator &o) const {
+    return i == o.i && j == o.j;
+  }
+  bool operator!=(const MatrixLineIterator &o) const { return !(*this == o); }
+
+ private:
+  M *m;
+  size_t i, j;
+  size_t di, dj;
+};
+
+// Walks an h x w block of M starting at (i0, j0), row by row
+template <typename M>
+class MatrixTileIterator {
+ public:
+  using reference = decltype(std::declval<M &>()(0, 0));
+  using value_type = typename std::remove_reference<reference>::type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = value_type *;
+  using iterator_category = std::forward_iterator_tag;
+
+  MatrixTileIterator(M *m, size_t i, size_t j, size_t j0, size_t j1)
+      : m(m), i(i), j(j), j0(j0), j1(j1) {}
+
+  reference operator*() const { return (*m)(i, j); }
+  MatrixTileIterator &operator++() {
+    if (++j == j1) {
+      j = j0;
+      i++;
+    }
+    return *this;
+  }
+  bool operator==(const MatrixTileIterator &o) const {
+    return i == o.i && j == o.j;
+  }
+  bool operator!=(const MatrixTileIterator &o) const { return !(*this == o); }
+
+ private:
+  M *m;
+  size_t i, j;
+  size_t j0, j1;
+};
+
+// begin/end pair for range-based for loops
+template <typename It>
+struct MatrixRange {
+  It first;
+  It last;
+  It begin() const { return first; }
+  It end() const { return last; }
+};
+
+template <typename T, typename Layout = RowMajor>
+class Matrix2D {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "elements live in raw aligned memory");
+
+ public:
+  // rows x cols elements, zeroed
+  Matrix2D(size_t rows, size_t cols)
+      : num_rows(rows), num_cols(cols), map(rows, cols) {
+    void *memory = nullptr;
+    size_t bytes = std::max<size_t>(map.size(), 1) * sizeof(T);
+    if (posix_memalign(&memory, 64, bytes)) throw std::bad_alloc();
+    storage.reset(static_cast<T *>(memory));
+    std::fill(storage.get(), storage.get() + map.size(), T());
+  }
+
+  size_t rows() const { return num_rows; }
+  size_t cols() const { return num_cols; }
+  const Layout &layout() const { return map; }
+
+  T &operator()(size_t i, size_t j) { return storage[map(i, j)]; }
+  const T &operator()(size_t i, size_t j) const { return storage[map(i, j)]; }
+
+  // Raw storage in layout order (including any padding)
+  T *data() { return storage.get(); }
+  const T *data() const { return storage.get(); }
+  size_t storage_size() const { return map.size(); }
+
+  // Elements of row i (left to right) and column j (top to bottom)
+  MatrixRange<MatrixLineIterator<Matrix2D>> row(size_t i) {
+    return line(this, i, 0, 0, 1, num_cols);
+  }
+  MatrixRange<MatrixLineIterator<const Matrix2D>> row(size_t i) const {
+    return line(this, i, 0, 0, 1, num_cols);
+  }
+  MatrixRange<MatrixLineIterator<Matrix2D>> col(size_t j) {
+    return line(this, 0, j, 1, 0, num_rows);
+  }
+  MatrixRange<MatrixLineIterator<const Matrix2D>> col(size_t j) const {
+    return line(this, 0, j, 1, 0, num_rows);
+  }
+
+  // Elements of the h x w block at (i0, j0) (clipped to the matrix), row
+  // by row
+  MatrixRange<MatrixTileIterator<Matrix2D>> tile(size_t i0, size_t j0,
+                                                  size_t h, size_t w) {
+    return block(this, i0, j0, h, w);
+  }
+  MatrixRange<MatrixTileIterator<const Matrix2D>> tile(size_t i0, size_t j0,
+                                                        size_t h,
+                                                        size_t w) const {
+    return block(this, i0, j0, h, w);
+  }
+
+ private:
+  template <typename M>
+  static MatrixRange<MatrixLineIterator<M>> line(M *m, size_t i, size_t j,
+                                                 size_t di, size_t dj,
+                                                 size_t count) {
+    return {{m, i, j, di, dj}, {m, i + di * count, j + dj * count, di, dj}};
+  }
+
+  template <typename M>
+  static MatrixRange<MatrixTileIterator<M>> block(M *m, size_t i0, size_t j0,
+                                                  size_t h, size_t w) {
+    size_t i1 = std::min(i0 + h, m->rows());
+    size_t j1 = std::min(j0 + w, m->cols());
+    // Empty blocks start at their end
+    if (i0 >= i1 || j0 >= j1) i1 = i0;
+    return {{m, i0, j0, j0, j1}, {m, i1, j0, j0, j1}};
+  }
+
+  struct Free {
+    void operator()(T *p) const { free(p); }
+  };
+
+  size_t num_rows;
+  size_t num_cols;
+  Layout map;
+  std::unique_ptr<T[], Free> storage;
+};
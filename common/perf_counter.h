@@ -0,0 +1,73 @@
+// A hardware event counter for the calling thread (a thin wrapper around
+// perf_event_open), so benchmarks can report things like TLB misses next
+// to their timings. Counts user space only, which works with the default
+// perf_event_paranoid setting. If the kernel or the machine (e.g. a VM
+// without a virtual PMU) doesn't support the event, valid() is false and
+// the counter reads 0.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+
+class PerfCounter {
+ public:
+  // type/config as in perf_event_open(2)
+  PerfCounter(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  // Data TLB misses on loads (page walks started by loads)
+  static PerfCounter dtlb_load_misses() {
+    return PerfCounter(PERF_TYPE_HW_CACHE,
+                       PERF_COUNT_HW_CACHE_DTLB |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  }
+
+  ~PerfCounter() {
+    if (fd >= 0) close(fd);
+  }
+
+  PerfCounter(PerfCounter &&other) noexcept : fd(other.fd) { other.fd = -1; }
+  PerfCounter(const PerfCounter &) = delete;
+  PerfCounter &operator=(const PerfCounter &) = delete;
+
+  bool valid() const { return fd >= 0; }
+
+  // Zero the count and start counting
+  void start() {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  void stop() {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  // Events counted between start() and stop()
+  uint64_t read() const {
+    uint64_t count = 0;
+    if (fd < 0 || ::read(fd, &count, sizeof(count)) != sizeof(count)) {
+      return 0;
+    }
+    return count;
+  }
+
+ private:
+  int fd = -1;
+};
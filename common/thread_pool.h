@@ -0,0 +1,113 @@
+// A small persistent pool of pinned worker threads
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Returns the list of CPUs this process is allowed to run on
+inline std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; i++) {
+      if (CPU_ISSET(i, &set)) cpus.push_back(i);
+    }
+  }
+  if (cpus.empty()) cpus.push_back(0);
+  return cpus;
+}
+
+// Workers are created once and pinned to a single CPU each. Every call
+// to run() hands the same job to all workers and waits for them to finish,
+// so a worker always sees the same thread id (and the same data) from one
+// call to the next. That is what makes first-touch page placement stick.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads) {
+    // Pin worker i to the i-th CPU we are allowed to use
+    std::vector<int> cpus = allowed_cpus();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([this, i] { worker(i); });
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+      pthread_setaffinity_np(threads.back().native_handle(), sizeof(set),
+                             &set);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop = true;
+    }
+    start_cv.notify_all();
+    for (auto &t : threads) t.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Number of worker threads
+  int size() const { return static_cast<int>(threads.size()); }
+
+  // Run job(thread_id) on every worker and wait for all of them
+  void run(const std::function<void(int)> &f) {
+    std::unique_lock<std::mutex> lock(m);
+    job = &f;
+    remaining = size();
+    generation++;
+    start_cv.notify_all();
+    done_cv.wait(lock, [this] { return remaining == 0; });
+    job = nullptr;
+  }
+
+ private:
+  void worker(int id) {
+    unsigned seen = 0;
+    while (true) {
+      const std::function<void(int)> *f;
+      {
+        // Wait for a new job (or for the pool to shut down)
+        std::unique_lock<std::mutex> lock(m);
+        start_cv.wait(lock, [&] { return stop || generation != seen; });
+        if (stop) return;
+        seen = generation;
+        f = job;
+      }
+
+      (*f)(id);
+
+      // The last worker to finish wakes up the caller
+      std::lock_guard<std::mutex> lock(m);
+      if (--remaining == 0) done_cv.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex m;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  const std::function<void(int)> *job = nullptr;
+  unsigned generation = 0;
+  int remaining = 0;
+  bool stop = false;
+};
+
+// Splits [0, n) into `parts` contiguous chunks and returns the bounds of
+// chunk `id`
+inline std::pair<int, int> split_range(int n, int parts, int id) {
+  long long begin = static_cast<long long>(n) * id / parts;
+  long long end = static_cast<long long>(n) * (id + 1) / parts;
+  return {static_cast<int>(begin), static_cast<int>(end)};
+}
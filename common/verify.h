@@ -0,0 +1,191 @@
+// Checking matrix multiplication results (C = A * B) without redoing the
+// O(N^3) multiply.
+//
+// Freivalds' algorithm: pick a random 0/1 vector r and compare A * (B * r)
+// with C * r, which is three O(N^2) matrix-vector products. If C is wrong
+// a round catches it with probability at least 1/2, so k rounds miss with
+// probability at most 2^-k. Small problems are checked exactly instead
+// (split across a thread pool).
+//
+// Integers are compared exactly (in wrapping unsigned arithmetic, so the
+// check is still right when the multiply overflows). Floating point
+// results are compared with a relative tolerance against the magnitude of
+// the terms that went into each sum.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "thread_pool.h"
+
+struct VerifyOptions {
+  // Largest chance that a wrong result passes (sets the Freivalds rounds)
+  double error_probability = 1e-9;
+  // Freivalds rounds (overrides error_probability when > 0)
+  int rounds = 0;
+  // Check exactly when m * n * k is at most this
+  int64_t exact_max_work = int64_t(1) << 24;
+  // Threads for the exact check (0 = one per allowed CPU)
+  int threads = 0;
+  // Relative tolerance for floating point results. Freivalds compares sums
+  // over whole rows, so a single wrong entry only gets caught if it is off
+  // by more than this times the magnitude of its row
+  double tolerance = 1e-5;
+  // Seed for the random vectors
+  uint64_t seed = 0x9e3779b97f4a7c15;
+};
+
+// Rounds needed to miss a wrong result with at most this probability
+inline int freivalds_rounds(double error_probability) {
+  if (error_probability <= 0) error_probability = 1e-300;
+  if (error_probability >= 1) return 1;
+  return std::max(1, int(std::ceil(-std::log2(error_probability))));
+}
+
+// Arithmetic the checks are done in (wrapping for integers)
+template <typename T, bool = std::is_integral<T>::value>
+struct VerifyAccum {
+  using type = double;
+};
+template <typename T>
+struct VerifyAccum<T, true> {
+  using type = typename std::make_unsigned<T>::type;
+};
+template <typename T>
+using verify_accum_t = typename VerifyAccum<T>::type;
+
+// Magnitudes (only needed for the floating point tolerance)
+inline double verify_abs(double x) { return std::abs(x); }
+template <typename U>
+inline U verify_abs(U x) {
+  return x;
+}
+
+// Does value match ref, where scale is the sum of the magnitudes of the
+// terms that went into ref?
+template <typename T>
+inline bool verify_close(verify_accum_t<T> value, verify_accum_t<T> ref,
+                         double scale, double tolerance) {
+  if (std::is_integral<T>::value) return value == ref;
+  return std::abs(double(value) - double(ref)) <= tolerance * scale + 1e-30;
+}
+
+// Exact check of C (m x n) = A (m x k) * B (k x n), with rows of C split
+// across the pool
+template <typename T>
+bool verify_gemm_exact(ThreadPool &pool, int m, int n, int k, const T *a,
+                       int lda, const T *b, int ldb, const T *c, int ldc,
+                       double tolerance = VerifyOptions().tolerance) {
+  using Acc = verify_accum_t<T>;
+  std::atomic<bool> ok{true};
+  pool.run([&](int id) {
+    auto rows = split_range(m, pool.size(), id);
+    std::vector<Acc> row(n), scale(n);
+    for (int i = rows.first; i < rows.second && ok.load(); i++) {
+      // Row i of A * B, i-k-j order so the inner loop runs along B
+      std::fill(row.begin(), row.end(), Acc(0));
+      std::fill(scale.begin(), scale.end(), Acc(0));
+      for (int p = 0; p < k; p++) {
+        Acc a_ip = Acc(a[static_cast<size_t>(i) * lda + p]);
+        const T *b_row = b + static_cast<size_t>(p) * ldb;
+        for (int j = 0; j < n; j++) row[j] += a_ip * Acc(b_row[j]);
+        if (!std::is_integral<T>::value) {
+          for (int j = 0; j < n; j++) {
+            scale[j] += verify_abs(a_ip * Acc(b_row[j]));
+          }
+        }
+      }
+      const T *c_row = c + static_cast<size_t>(i) * ldc;
+      for (int j = 0; j < n; j++) {
+        if (!verify_close<T>(Acc(c_row[j]), row[j], double(scale[j]),
+                             tolerance)) {
+          ok = false;
+          break;
+        }
+      }
+    }
+  });
+  return ok;
+}
+
+// Freivalds check of C (m x n) = A (m x k) * B (k x n)
+template <typename T>
+bool verify_gemm_freivalds(int m, int n, int k, const T *a, int lda,
+                           const T *b, int ldb, const T *c, int ldc,
+                           int rounds, uint64_t seed = VerifyOptions().seed,
+                           double tolerance = VerifyOptions().tolerance) {
+  using Acc = verify_accum_t<T>;
+  const bool integral = std::is_integral<T>::value;
+  std::vector<Acc> r(n), br(k), abs_br(k);
+  uint64_t state = seed ? seed : 1;
+
+  for (int round = 0; round < rounds; round++) {
+    // Random 0/1 vector (xorshift64)
+    for (int j = 0; j < n; j++) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      r[j] = Acc(state >> 63);
+    }
+
+    // B * r (and |B| * r for the tolerance)
+    for (int p = 0; p < k; p++) {
+      const T *b_row = b + static_cast<size_t>(p) * ldb;
+      Acc sum = 0, abs_sum = 0;
+      for (int j = 0; j < n; j++) {
+        sum += Acc(b_row[j]) * r[j];
+        if (!integral) abs_sum += verify_abs(Acc(b_row[j])) * r[j];
+      }
+      br[p] = sum;
+      abs_br[p] = abs_sum;
+    }
+
+    // A * (B * r) against C * r, one row at a time
+    for (int i = 0; i < m; i++) {
+      const T *a_row = a + static_cast<size_t>(i) * lda;
+      const T *c_row = c + static_cast<size_t>(i) * ldc;
+      Acc abr = 0, cr = 0;
+      double scale = 0;
+      for (int p = 0; p < k; p++) abr += Acc(a_row[p]) * br[p];
+      for (int j = 0; j < n; j++) cr += Acc(c_row[j]) * r[j];
+      if (!integral) {
+        for (int p = 0; p < k; p++) {
+          scale += verify_abs(double(a_row[p])) * double(abs_br[p]);
+        }
+      }
+      if (!verify_close<T>(cr, abr, scale, tolerance)) return false;
+    }
+  }
+  return true;
+}
+
+// Check C (m x n) = A (m x k) * B (k x n): exactly for small problems,
+// with Freivalds' algorithm otherwise
+template <typename T>
+bool verify_gemm(int m, int n, int k, const T *a, int lda, const T *b,
+                 int ldb, const T *c, int ldc,
+                 const VerifyOptions &opt = VerifyOptions()) {
+  if (int64_t(m) * n * k <= opt.exact_max_work) {
+    int threads = opt.threads > 0 ? opt.threads
+                                  : static_cast<int>(allowed_cpus().size());
+    ThreadPool pool(std::min(threads, std::max(1, m)));
+    return verify_gemm_exact(pool, m, n, k, a, lda, b, ldb, c, ldc,
+                             opt.tolerance);
+  }
+  int rounds = opt.rounds > 0 ? opt.rounds
+                              : freivalds_rounds(opt.error_probability);
+  return verify_gemm_freivalds(m, n, k, a, lda, b, ldb, c, ldc, rounds,
+                               opt.seed, opt.tolerance);
+}
+
+// Square N x N version (C = A * B), like the benchmarks use
+template <typename T>
+bool verify_mmul(const T *a, const T *b, const T *c, int N,
+                 const VerifyOptions &opt = VerifyOptions()) {
+  return verify_gemm(N, N, N, a, N, b, N, c, N, opt);
+}
@@ -0,0 +1,269 @@
+// Autotuning for the blocked gemm: searches the cache blocking (MC/KC/NC)
+// and the register tile (MR x NR) with a short benchmark, and keeps the
+// winner in a cache file keyed by CPU model, so each machine only has to
+// search once.
+//
+// gemm_tuning<T>() is what the multiplies use. On the first call it
+// loads the tuning for this CPU from the cache file. If there is none it
+// runs the search when GEMM_AUTOTUNE is set (and saves the result), and
+// otherwise uses the defaults. The cache file is $GEMM_TUNING_CACHE, or
+// else ~/.gemm_tuning.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gemm.h"
+
+// Everything we tune
+struct GemmTuning {
+  GemmBlocking blk;
+  int mr;
+  int nr;
+};
+
+// Register tiles we can run (each one is a separate gemm instantiation).
+// With AVX2's 16 registers, MR * NR / 8 accumulators plus NR / 8 loads of
+// B and one broadcast of A must fit.
+struct RegisterTile {
+  int mr;
+  int nr;
+};
+constexpr RegisterTile register_tiles[] = {
+    {4, 16}, {6, 16}, {8, 8}, {12, 8}, {4, 24}};
+
+template <typename T>
+using tuned_gemm_kernel = void (*)(int, int, int, const T *, int, const T *,
+                                   int, T *, int, GemmBlocking);
+
+// The gemm instantiation for a register tile (nullptr if we don't have it)
+template <typename T>
+inline tuned_gemm_kernel<T> gemm_kernel_for_tile(int mr, int nr) {
+  if (mr == 4 && nr == 16) return gemm<T, 4, 16>;
+  if (mr == 6 && nr == 16) return gemm<T, 6, 16>;
+  if (mr == 8 && nr == 8) return gemm<T, 8, 8>;
+  if (mr == 12 && nr == 8) return gemm<T, 12, 8>;
+  if (mr == 4 && nr == 24) return gemm<T, 4, 24>;
+  return nullptr;
+}
+
+template <typename T>
+inline GemmTuning default_tuning() {
+  return {default_blocking<T>(), default_mr, default_nr};
+}
+
+template <typename T>
+inline const char *tuning_type_name();
+template <>
+inline const char *tuning_type_name<int>() {
+  return "int";
+}
+template <>
+inline const char *tuning_type_name<float>() {
+  return "float";
+}
+
+// CPU model string from /proc/cpuinfo (the cache key)
+inline std::string cpu_model_name() {
+  std::string model = "unknown";
+  FILE *f = fopen("/proc/cpuinfo", "r");
+  if (!f) return model;
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "model name", 10) != 0) continue;
+    const char *value = strchr(line, ':');
+    if (!value) continue;
+    value++;
+    while (*value == ' ' || *value == '\t') value++;
+    model = value;
+    while (!model.empty() && (model.back() == '\n' || model.back() == ' ')) {
+      model.pop_back();
+    }
+    break;
+  }
+  fclose(f);
+  return model;
+}
+
+inline std::string tuning_cache_path() {
+  if (const char *path = getenv("GEMM_TUNING_CACHE")) return path;
+  if (const char *home = getenv("HOME")) {
+    return std::string(home) + "/.gemm_tuning";
+  }
+  return ".gemm_tuning";
+}
+
+// Cache file lines look like:
+//   <type> <mc> <kc> <nc> <mr> <nr> <cpu model...>
+// Returns false if there's no usable entry for this type and CPU
+template <typename T>
+bool load_gemm_tuning(GemmTuning &tuning,
+                      const std::string &path = tuning_cache_path(),
+                      const std::string &model = cpu_model_name()) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[1024];
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), f)) {
+    char type[16];
+    GemmTuning t;
+    int used = 0;
+    if (sscanf(line, "%15s %d %d %d %d %d %n", type, &t.blk.mc, &t.blk.kc,
+               &t.blk.nc, &t.mr, &t.nr, &used) != 6) {
+      continue;
+    }
+    std::string line_model = line + used;
+    while (!line_model.empty() && line_model.back() == '\n') {
+      line_model.pop_back();
+    }
+    if (strcmp(type, tuning_type_name<T>()) == 0 && line_model == model &&
+        gemm_kernel_for_tile<T>(t.mr, t.nr)) {
+      tuning = t;
+      found = true;
+    }
+  }
+  fclose(f);
+  return found;
+}
+
+// Replace (or add) the entry for this type and CPU
+template <typename T>
+bool save_gemm_tuning(const GemmTuning &tuning,
+                      const std::string &path = tuning_cache_path(),
+                      const std::string &model = cpu_model_name()) {
+  // Keep every other entry
+  std::vector<std::string> lines;
+  if (FILE *f = fopen(path.c_str(), "r")) {
+    char line[1024];
+    std::string prefix = std::string(tuning_type_name<T>()) + " ";
+    while (fgets(line, sizeof(line), f)) {
+      std::string l = line;
+      bool same_type = l.compare(0, prefix.size(), prefix) == 0;
+      bool same_model = l.size() > model.size() + 1 &&
+                        l.compare(l.size() - model.size() - 1, model.size(),
+                                  model) == 0;
+      if (!(same_type && same_model)) lines.push_back(l);
+    }
+    fclose(f);
+  }
+
+  // Write a new file and move it into place (so readers never see half)
+  std::string tmp = path + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f) return false;
+  for (const auto &l : lines) fputs(l.c_str(), f);
+  fprintf(f, "%s %d %d %d %d %d %s\n", tuning_type_name<T>(), tuning.blk.mc,
+          tuning.blk.kc, tuning.blk.nc, tuning.mr, tuning.nr, model.c_str());
+  bool ok = fclose(f) == 0;
+  return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// C (m x n) += A (m x k) * B (k x n) with a tuning
+template <typename T>
+inline void tuned_gemm(const GemmTuning &tuning, int m, int n, int k,
+                       const T *a, int lda, const T *b, int ldb, T *c,
+                       int ldc) {
+  auto kernel = gemm_kernel_for_tile<T>(tuning.mr, tuning.nr);
+  if (!kernel) kernel = gemm<T, default_mr, default_nr>;
+  kernel(m, n, k, a, lda, b, ldb, c, ldc, tuning.blk);
+}
+
+// Search for the fastest tuning on N x N multiplies. We go one knob at a
+// time (register tile, then KC, MC and NC), keeping the best value of
+// each, which is much cheaper than trying every combination.
+template <typename T>
+GemmTuning autotune_gemm(int N = 1024) {
+  std::vector<T> a(static_cast<size_t>(N) * N);
+  std::vector<T> b(a.size());
+  std::vector<T> c(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Best of a few runs (the first one warms up the caches)
+  auto time = [&](const GemmTuning &t) {
+    double best = 1e30;
+    for (int rep = 0; rep < 3; rep++) {
+      auto start = std::chrono::steady_clock::now();
+      tuned_gemm(t, N, N, N, a.data(), N, b.data(), N, c.data(), N);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+    }
+    return best;
+  };
+
+  GemmTuning best = default_tuning<T>();
+  double best_time = time(best);
+  auto consider = [&](GemmTuning t) {
+    double elapsed = time(t);
+    if (elapsed < best_time) {
+      best = t;
+      best_time = elapsed;
+    }
+  };
+
+  // Register tile (MC rounded to whole tiles, like gemm does)
+  for (const auto &tile : register_tiles) {
+    GemmTuning t = best;
+    t.mr = tile.mr;
+    t.nr = tile.nr;
+    t.blk.mc = std::max(tile.mr, best.blk.mc / tile.mr * tile.mr);
+    consider(t);
+  }
+
+  // KC (how deep a sliver the micro-kernel streams from L1)
+  for (int kc : {64, 128, 192, 256, 384, 512}) {
+    GemmTuning t = best;
+    t.blk.kc = kc;
+    consider(t);
+  }
+
+  // MC (how many rows of A we keep in L2)
+  for (int rows : {24, 48, 72, 96, 144, 192, 288}) {
+    GemmTuning t = best;
+    t.blk.mc = std::max(t.mr, rows / t.mr * t.mr);
+    consider(t);
+  }
+
+  // NC (how many columns of B we keep in L3)
+  for (int cols : {512, 1024, 2048, 4080, 8192}) {
+    GemmTuning t = best;
+    t.blk.nc = std::max(t.nr, cols / t.nr * t.nr);
+    consider(t);
+  }
+
+  return best;
+}
+
+// The tuning for this machine (loaded, searched or default; see the top)
+template <typename T>
+const GemmTuning &gemm_tuning() {
+  static const GemmTuning tuning = [] {
+    GemmTuning t = default_tuning<T>();
+    if (load_gemm_tuning<T>(t)) return t;
+    if (getenv("GEMM_AUTOTUNE")) {
+      t = autotune_gemm<T>();
+      save_gemm_tuning<T>(t);
+    }
+    return t;
+  }();
+  return tuning;
+}
+
+// Drop-in replacements for base_mmul (square N x N, C += A * B)
+inline void tuned_mmul(const int *a, const int *b, int *c, const int N) {
+  tuned_gemm(gemm_tuning<int>(), N, N, N, a, N, b, N, c, N);
+}
+
+inline void tuned_mmul(const float *a, const float *b, float *c,
+                       const int N) {
+  tuned_gemm(gemm_tuning<float>(), N, N, N, a, N, b, N, c, N);
+}
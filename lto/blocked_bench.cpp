@@ -0,0 +1,76 @@
+// This program compares our baseline matrix multiplication against a
+// cache-blocked version with a register-tiled micro-kernel
+// Build: g++ -O3 -march=native blocked_bench.cpp base_mmul.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include "../common/verify.h"
+#include "gemm.h"
+
+// Function prototypes
+void base_mmul(const int *a, const int *b, int *c, const int N);
+
+// The same triple loop as base_mmul for floats
+void base_mmul(const float *a, const float *b, float *c, const int N) {
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = 0; k < N; k++) {
+        c[i * N + j] += a[i * N + k] * b[k * N + j];
+      }
+    }
+  }
+}
+
+// Run one of the multiplies on random N x N matrices
+template <typename T, void (*mmul)(const T *, const T *, T *, const int)>
+static void mmulBench(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // Allocate for our matrices
+  T *a = new T[N * N];
+  T *b = new T[N * N];
+  T *c = new T[N * N]();
+  for (int i = 0; i < N * N; i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Check the result before timing anything
+  mmul(a, b, c, N);
+  if (!verify_mmul(a, b, c, N)) s.SkipWithError("Incorrect result");
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul(a, b, c, N);
+  }
+
+  // Free our memory
+  delete[] a;
+  delete[] b;
+  delete[] c;
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+
+// Our baseline (in another translation unit, like multi_tu_bench.cpp)
+static void baseline(benchmark::State &s) { mmulBench<int, base_mmul>(s); }
+BENCHMARK(baseline)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void blocked(benchmark::State &s) { mmulBench<int, blocked_mmul>(s); }
+BENCHMARK(blocked)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void baselineFloat(benchmark::State &s) {
+  mmulBench<float, base_mmul>(s);
+}
+BENCHMARK(baselineFloat)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void blockedFloat(benchmark::State &s) {
+  mmulBench<float, blocked_mmul>(s);
+}
+BENCHMARK(blockedFloat)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,285 @@
+// A cache-blocked matrix multiplication (C += A * B) for int and float,
+// organized like BLIS/GotoBLAS:
+//   - B is packed into a KC x NC block (sized for the L3 cache)
+//   - A is packed into an MC x KC block (sized for the L2 cache)
+//   - a register-tiled MR x NR micro-kernel multiplies an MR x KC sliver
+//     of A by a KC x NR sliver of B (sized for the L1 cache), keeping the
+//     whole MR x NR tile of C in vector registers
+// Compile with -O3 -march=native (or at least -mavx2 -mfma) so the
+// micro-kernel uses AVX2. Without it we fall back to scalar "vectors".
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// SIMD operations the micro-kernel needs (one set per element type)
+template <typename T>
+struct SimdTraits;
+
+#ifdef __AVX2__
+template <>
+struct SimdTraits<float> {
+  using reg = __m256;
+  static constexpr int width = 8;
+  static reg zero() { return _mm256_setzero_ps(); }
+  static reg set1(float x) { return _mm256_set1_ps(x); }
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, reg x) { _mm256_storeu_ps(p, x); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg fma(reg a, reg b, reg c) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+  }
+};
+
+template <>
+struct SimdTraits<int> {
+  using reg = __m256i;
+  static constexpr int width = 8;
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg set1(int x) { return _mm256_set1_epi32(x); }
+  static reg load(const int *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static void store(int *p, reg x) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), x);
+  }
+  static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+  static reg fma(reg a, reg b, reg c) {
+    return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c);
+  }
+};
+#else
+// Scalar fallback (each "register" is one element)
+template <typename T>
+struct SimdTraits {
+  using reg = T;
+  static constexpr int width = 1;
+  static reg zero() { return 0; }
+  static reg set1(T x) { return x; }
+  static reg load(const T *p) { return *p; }
+  static void store(T *p, reg x) { *p = x; }
+  static reg add(reg a, reg b) { return a + b; }
+  static reg fma(reg a, reg b, reg c) { return a * b + c; }
+};
+#endif
+
+// Cache blocking parameters
+struct GemmBlocking {
+  int mc;  // Rows of A per packed block (L2)
+  int kc;  // Depth of each packed block (L1, together with MR/NR)
+  int nc;  // Columns of B per packed block (L3)
+};
+
+// Default register tile (6 x 16 fits 12 accumulators + 3 temporaries in
+// the 16 AVX2 registers)
+constexpr int default_mr = 6;
+constexpr int default_nr = 16;
+
+template <typename T>
+inline GemmBlocking default_blocking() {
+  return {72, 256, 4080};
+}
+
+// Simple 64-byte aligned buffer that only grows
+template <typename T>
+class AlignedBuffer {
+ public:
+  AlignedBuffer() = default;
+  explicit AlignedBuffer(size_t n) { reserve(n); }
+  AlignedBuffer(const AlignedBuffer &) = delete;
+  AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+  AlignedBuffer(AlignedBuffer &&other) noexcept
+      : ptr(other.ptr), capacity(other.capacity) {
+    other.ptr = nullptr;
+    other.capacity = 0;
+  }
+  AlignedBuffer &operator=(AlignedBuffer &&other) noexcept {
+    std::swap(ptr, other.ptr);
+    std::swap(capacity, other.capacity);
+    return *this;
+  }
+  ~AlignedBuffer() { free(ptr); }
+
+  void reserve(size_t n) {
+    if (n <= capacity) return;
+    free(ptr);
+    void *memory;
+    if (posix_memalign(&memory, 64, n * sizeof(T))) abort();
+    ptr = static_cast<T *>(memory);
+    capacity = n;
+  }
+
+  T *data() { return ptr; }
+  const T *data() const { return ptr; }
+
+ private:
+  T *ptr = nullptr;
+  size_t capacity = 0;
+};
+
+// Packing -----------------------------------------------------------------
+
+// Pack an mc x kc block of A into MR-row slivers: for each sliver, all MR
+// elements of column k are next to each other. Missing rows are zeroed.
+template <typename T, int MR>
+inline void gemm_pack_a(int mc, int kc, const T *a, int lda, T *packed) {
+  for (int ir = 0; ir < mc; ir += MR) {
+    int rows = std::min(MR, mc - ir);
+    for (int k = 0; k < kc; k++) {
+      for (int i = 0; i < rows; i++) {
+        packed[i] = a[static_cast<size_t>(ir + i) * lda + k];
+      }
+      for (int i = rows; i < MR; i++) packed[i] = 0;
+      packed += MR;
+    }
+  }
+}
+
+// Pack a kc x nc block of B into NR-column slivers: for each sliver, the
+// NR elements of row k are next to each other. Missing columns are zeroed.
+template <typename T, int NR>
+inline void gemm_pack_b(int kc, int nc, const T *b, int ldb, T *packed) {
+  for (int jr = 0; jr < nc; jr += NR) {
+    int cols = std::min(NR, nc - jr);
+    for (int k = 0; k < kc; k++) {
+      const T *row = b + static_cast<size_t>(k) * ldb + jr;
+      for (int j = 0; j < cols; j++) packed[j] = row[j];
+      for (int j = cols; j < NR; j++) packed[j] = 0;
+      packed += NR;
+    }
+  }
+}
+
+// Size of a packed block (rounded up to whole slivers)
+template <int R>
+inline size_t gemm_packed_size(int rows_or_cols, int kc) {
+  return static_cast<size_t>((rows_or_cols + R - 1) / R) * R * kc;
+}
+
+// Kernels -----------------------------------------------------------------
+
+// C[m x n] += A sliver (MR x kc) * B sliver (kc x NR), with m <= MR and
+// n <= NR for tiles on the edge of C
+template <typename T, int MR, int NR>
+inline void gemm_micro_kernel(int kc, const T *a, const T *b, T *c, int ldc,
+                              int m, int n) {
+  using S = SimdTraits<T>;
+  using reg = typename S::reg;
+  constexpr int NV = NR / S::width;
+  static_assert(NR % S::width == 0, "NR must be a multiple of the SIMD width");
+
+  // The whole tile of C lives in registers
+  reg acc[MR][NV];
+#pragma GCC unroll 16
+  for (int i = 0; i < MR; i++) {
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; v++) acc[i][v] = S::zero();
+  }
+
+  // Rank-1 update per k: NV loads of B, MR broadcasts of A
+  for (int k = 0; k < kc; k++) {
+    reg bv[NV];
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; v++) bv[v] = S::load(b + v * S::width);
+#pragma GCC unroll 16
+    for (int i = 0; i < MR; i++) {
+      reg av = S::set1(a[i]);
+#pragma GCC unroll 16
+      for (int v = 0; v < NV; v++) acc[i][v] = S::fma(av, bv[v], acc[i][v]);
+    }
+    a += MR;
+    b += NR;
+  }
+
+  // Full tiles go straight to C
+  if (m == MR && n == NR) {
+#pragma GCC unroll 16
+    for (int i = 0; i < MR; i++) {
+#pragma GCC unroll 16
+      for (int v = 0; v < NV; v++) {
+        T *dst = c + static_cast<size_t>(i) * ldc + v * S::width;
+        S::store(dst, S::add(S::load(dst), acc[i][v]));
+      }
+    }
+    return;
+  }
+
+  // Edge tiles go through a temporary
+  alignas(64) T tmp[MR * NR];
+  for (int i = 0; i < MR; i++) {
+    for (int v = 0; v < NV; v++) {
+      S::store(tmp + i * NR + v * S::width, acc[i][v]);
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      c[static_cast<size_t>(i) * ldc + j] += tmp[i * NR + j];
+    }
+  }
+}
+
+// C[mc x nc] += packed A block * packed B block
+template <typename T, int MR, int NR>
+inline void gemm_macro_kernel(int mc, int nc, int kc, const T *packed_a,
+                              const T *packed_b, T *c, int ldc) {
+  for (int jr = 0; jr < nc; jr += NR) {
+    for (int ir = 0; ir < mc; ir += MR) {
+      gemm_micro_kernel<T, MR, NR>(
+          kc, packed_a + static_cast<size_t>(ir) * kc,
+          packed_b + static_cast<size_t>(jr) * kc,
+          c + static_cast<size_t>(ir) * ldc + jr, ldc, std::min(MR, mc - ir),
+          std::min(NR, nc - jr));
+    }
+  }
+}
+
+// Driver ------------------------------------------------------------------
+
+// C (m x n) += A (m x k) * B (k x n), all row-major with leading dimensions
+template <typename T, int MR = default_mr, int NR = default_nr>
+void gemm(int m, int n, int k, const T *a, int lda, const T *b, int ldb, T *c,
+          int ldc, GemmBlocking blk = default_blocking<T>()) {
+  // Keep the blocks a whole number of register tiles
+  blk.mc = std::max(MR, blk.mc / MR * MR);
+  blk.nc = std::max(NR, blk.nc / NR * NR);
+  blk.kc = std::max(1, blk.kc);
+
+  AlignedBuffer<T> packed_a(gemm_packed_size<MR>(std::min(blk.mc, m), blk.kc));
+  AlignedBuffer<T> packed_b(gemm_packed_size<NR>(std::min(blk.nc, n), blk.kc));
+
+  for (int jc = 0; jc < n; jc += blk.nc) {
+    int nc = std::min(blk.nc, n - jc);
+    for (int pc = 0; pc < k; pc += blk.kc) {
+      int kc = std::min(blk.kc, k - pc);
+      gemm_pack_b<T, NR>(kc, nc, b + static_cast<size_t>(pc) * ldb + jc, ldb,
+                         packed_b.data());
+      for (int ic = 0; ic < m; ic += blk.mc) {
+        int mc = std::min(blk.mc, m - ic);
+        gemm_pack_a<T, MR>(mc, kc, a + static_cast<size_t>(ic) * lda + pc, lda,
+                           packed_a.data());
+        gemm_macro_kernel<T, MR, NR>(mc, nc, kc, packed_a.data(),
+                                     packed_b.data(),
+                                     c + static_cast<size_t>(ic) * ldc + jc,
+                                     ldc);
+      }
+    }
+  }
+}
+
+// Drop-in replacements for base_mmul (square N x N, C += A * B)
+inline void blocked_mmul(const int *a, const int *b, int *c, const int N) {
+  gemm<int>(N, N, N, a, N, b, N, c, N);
+}
+
+inline void blocked_mmul(const float *a, const float *b, float *c,
+                         const int N) {
+  gemm<float>(N, N, N, a, N, b, N, c, N);
+}
@@ -0,0 +1,141 @@
+// This program compares the int8 / int16 / int32 integer GEMM paths
+// against base_mmul and the blocked multiply on rand() % 100 matrices
+// (which fit in 8 bits), plus the range-checked dispatch on inputs that
+// need the int16 path or the int32 fallback
+// Build: g++ -O3 -march=native int_bench.cpp base_mmul.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include "../common/verify.h"
+#include "int_gemm.h"
+
+// Function prototypes
+void base_mmul(const int *a, const int *b, int *c, const int N);
+
+// Random N x N matrix with values in [0, range)
+static std::vector<int> randomMatrix(int N, int range) {
+  std::vector<int> v(size_t(N) * N);
+  for (auto &x : v) x = rand() % range;
+  return v;
+}
+
+// Items are multiply-adds
+static void setCounters(benchmark::State &s, int N) {
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+
+// Our baseline (in another translation unit, like multi_tu_bench.cpp)
+static void baseline(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+  auto a = randomMatrix(N, 100);
+  auto b = randomMatrix(N, 100);
+  std::vector<int> c(a.size());
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    base_mmul(a.data(), b.data(), c.data(), N);
+  }
+
+  setCounters(s, N);
+}
+BENCHMARK(baseline)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+// One of the int_gemm paths (forced)
+static void intPath(benchmark::State &s, IntGemmPath path) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+  auto a = randomMatrix(N, 100);
+  auto b = randomMatrix(N, 100);
+  std::vector<int> c(a.size());
+
+  // Check the result before timing anything
+  int_gemm(path, N, N, N, a.data(), N, b.data(), N, c.data(), N);
+  if (!verify_mmul(a.data(), b.data(), c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    int_gemm(path, N, N, N, a.data(), N, b.data(), N, c.data(), N);
+  }
+
+  setCounters(s, N);
+}
+BENCHMARK_CAPTURE(intPath, int32, IntGemmPath::int32)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(intPath, int16, IntGemmPath::int16)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(intPath, int8, IntGemmPath::int8)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+// Input ranges ([0, range_a) for A and [0, range_b) for B) that need the
+// given path, but that keep every dot product of length N inside int32
+// (N * max(A) * max(B) < 2^31), so the int32 fallback stays exact
+static std::pair<int, int> dispatchRanges(IntGemmPath path, int N) {
+  const int64_t limit = int64_t(1) << 31;
+  switch (path) {
+    case IntGemmPath::int8:
+      return {100, 100};
+    case IntGemmPath::int16: {
+      // Above 127, so int8 won't do
+      int range = 1;
+      while (int64_t(N) * (2 * range) * (2 * range) < limit) range *= 2;
+      return {range, range};
+    }
+    default:
+      // B goes past 16 bits, and A is just small enough to make up for it
+      return {static_cast<int>(limit / (int64_t(N) << 16)), 1 << 16};
+  }
+}
+
+// The range-checked entry point (including the cost of the check) on
+// inputs that fit 8 bits, 16 bits, or neither
+static void intDispatch(benchmark::State &s, IntGemmPath expected) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+  auto ranges = dispatchRanges(expected, N);
+  auto a = randomMatrix(N, ranges.first);
+  auto b = randomMatrix(N, ranges.second);
+  std::vector<int> c(a.size());
+
+  // Check the result (and the path it took) before timing anything
+  IntGemmPath path = int_gemm(N, N, N, a.data(), N, b.data(), N, c.data(), N);
+  if (path != expected) {
+    s.SkipWithError("Unexpected path");
+  } else if (!verify_mmul(a.data(), b.data(), c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile. Each call adds close to the int32 limit to C, so
+  // it starts from zero every time.
+  while (s.KeepRunning()) {
+    s.PauseTiming();
+    std::fill(c.begin(), c.end(), 0);
+    s.ResumeTiming();
+    path = int_gemm(N, N, N, a.data(), N, b.data(), N, c.data(), N);
+  }
+
+  setCounters(s, N);
+  s.SetLabel(int_gemm_path_name(path));
+}
+BENCHMARK_CAPTURE(intDispatch, 8bit, IntGemmPath::int8)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(intDispatch, 16bit, IntGemmPath::int16)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(intDispatch, 32bit, IntGemmPath::int32)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,290 @@
+// Integer matrix multiplication (C += A * B, int32 in and out) that uses
+// narrower multiplies when the inputs allow it:
+//   - int8:  A in [0, 127], B in [-128, 127]. _mm256_maddubs_epi16 does
+//            32 byte products per instruction (adjacent pairs summed into
+//            int16), then _mm256_madd_epi16 with ones widens to int32
+//   - int16: A and B in [-32767, 32767]. _mm256_madd_epi16 does 16
+//            products per instruction (adjacent pairs summed into int32)
+//   - int32: anything else goes to the blocked gemm (8 products per
+//            _mm256_mullo_epi32)
+// The inputs are range-checked on every call to pick the narrowest path.
+//
+// Both narrow paths pack G = 4 / sizeof(element) consecutive k values
+// together, so every packed group is one 32-bit word: A is broadcast one
+// word per row, and B is loaded 8 columns (words) at a time. Compile with
+// -O3 -march=native (or -mavx2); without AVX2 everything uses int32.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "gemm.h"
+
+enum class IntGemmPath { int8, int16, int32 };
+
+inline const char *int_gemm_path_name(IntGemmPath path) {
+  switch (path) {
+    case IntGemmPath::int8:
+      return "int8";
+    case IntGemmPath::int16:
+      return "int16";
+    default:
+      return "int32";
+  }
+}
+
+// Smallest and largest value of a rows x cols block
+inline std::pair<int, int> int_value_range(int rows, int cols, const int *x,
+                                           int ld) {
+  int lo = 0, hi = 0;
+  if (rows > 0 && cols > 0) lo = hi = x[0];
+  for (int i = 0; i < rows; i++) {
+    const int *row = x + static_cast<size_t>(i) * ld;
+    for (int j = 0; j < cols; j++) {
+      lo = std::min(lo, row[j]);
+      hi = std::max(hi, row[j]);
+    }
+  }
+  return {lo, hi};
+}
+
+// Narrowest path that is exact for these inputs. The int8 bounds keep the
+// pairwise int16 sums of maddubs from saturating (2 * 127 * 128 < 2^15),
+// and the int16 bounds keep madd's pair sums inside int32.
+inline IntGemmPath int_gemm_path(int m, int n, int k, const int *a, int lda,
+                                 const int *b, int ldb) {
+#ifdef __AVX2__
+  auto ra = int_value_range(m, k, a, lda);
+  auto rb = int_value_range(k, n, b, ldb);
+  if (ra.first >= 0 && ra.second <= 127 && rb.first >= -128 &&
+      rb.second <= 127) {
+    return IntGemmPath::int8;
+  }
+  if (ra.first >= -32767 && ra.second <= 32767 && rb.first >= -32767 &&
+      rb.second <= 32767) {
+    return IntGemmPath::int16;
+  }
+#else
+  (void)m, (void)n, (void)k, (void)a, (void)lda, (void)b, (void)ldb;
+#endif
+  return IntGemmPath::int32;
+}
+
+#ifdef __AVX2__
+
+// 32-bit dot products of packed groups (TA from A, TB from B)
+template <typename TA, typename TB>
+struct IntDot;
+
+template <>
+struct IntDot<int16_t, int16_t> {
+  static __m256i dot(__m256i a, __m256i b) { return _mm256_madd_epi16(a, b); }
+};
+
+template <>
+struct IntDot<uint8_t, int8_t> {
+  static __m256i dot(__m256i a, __m256i b) {
+    __m256i pairs = _mm256_maddubs_epi16(a, b);
+    return _mm256_madd_epi16(pairs, _mm256_set1_epi16(1));
+  }
+};
+
+// Pack an mc x kc block of A into MR-row slivers of G-element groups: for
+// each group of k, the G values of each of the MR rows are next to each
+// other. kc is a multiple of G, and missing rows (or k past the end of A,
+// given by k_end) are zeroed.
+template <typename T, int MR>
+inline void int_gemm_pack_a(int mc, int kc, int k_end, const int *a, int lda,
+                            T *packed) {
+  constexpr int G = 4 / sizeof(T);
+  for (int ir = 0; ir < mc; ir += MR) {
+    int rows = std::min(MR, mc - ir);
+    for (int k = 0; k < kc; k += G) {
+      for (int i = 0; i < MR; i++) {
+        for (int g = 0; g < G; g++) {
+          T value = 0;
+          if (i < rows && k + g < k_end) {
+            size_t row = static_cast<size_t>(ir + i) * lda;
+            value = static_cast<T>(a[row + k + g]);
+          }
+          packed[i * G + g] = value;
+        }
+      }
+      packed += MR * G;
+    }
+  }
+}
+
+// Pack a kc x nc block of B into NR-column slivers of G-element groups:
+// for each group of k, the G values of each of the NR columns are next to
+// each other
+template <typename T, int NR>
+inline void int_gemm_pack_b(int kc, int nc, int k_end, const int *b, int ldb,
+                            T *packed) {
+  constexpr int G = 4 / sizeof(T);
+  for (int jr = 0; jr < nc; jr += NR) {
+    int cols = std::min(NR, nc - jr);
+    for (int k = 0; k < kc; k += G) {
+      for (int j = 0; j < NR; j++) {
+        for (int g = 0; g < G; g++) {
+          T value = 0;
+          if (j < cols && k + g < k_end) {
+            size_t row = static_cast<size_t>(k + g) * ldb;
+            value = static_cast<T>(b[row + jr + j]);
+          }
+          packed[j * G + g] = value;
+        }
+      }
+      packed += NR * G;
+    }
+  }
+}
+
+// C[m x n] += A sliver * B sliver over kc / G groups (m <= MR, n <= NR)
+template <typename TA, typename TB, int MR, int NR>
+inline void int_gemm_micro_kernel(int groups, const TA *a, const TB *b,
+                                  int *c, int ldc, int m, int n) {
+  using S = SimdTraits<int>;
+  constexpr int G = 4 / sizeof(TA);
+  constexpr int NV = NR / 8;
+  static_assert(NR % 8 == 0, "NR must be a multiple of 8");
+
+  __m256i acc[MR][NV];
+#pragma GCC unroll 16
+  for (int i = 0; i < MR; i++) {
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; v++) acc[i][v] = _mm256_setzero_si256();
+  }
+
+  // One group of k per step: NV loads of B, MR broadcasts of A
+  for (int g = 0; g < groups; g++) {
+    __m256i bv[NV];
+#pragma GCC unroll 16
+    for (int v = 0; v < NV; v++) {
+      bv[v] = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(b + v * 8 * G));
+    }
+#pragma GCC unroll 16
+    for (int i = 0; i < MR; i++) {
+      int32_t word;
+      std::memcpy(&word, a + i * G, sizeof(word));
+      __m256i av = _mm256_set1_epi32(word);
+#pragma GCC unroll 16
+      for (int v = 0; v < NV; v++) {
+        acc[i][v] =
+            _mm256_add_epi32(acc[i][v], IntDot<TA, TB>::dot(av, bv[v]));
+      }
+    }
+    a += MR * G;
+    b += NR * G;
+  }
+
+  // Full tiles go straight to C
+  if (m == MR && n == NR) {
+#pragma GCC unroll 16
+    for (int i = 0; i < MR; i++) {
+#pragma GCC unroll 16
+      for (int v = 0; v < NV; v++) {
+        int *dst = c + static_cast<size_t>(i) * ldc + v * 8;
+        S::store(dst, S::add(S::load(dst), acc[i][v]));
+      }
+    }
+    return;
+  }
+
+  // Edge tiles go through a temporary
+  alignas(64) int tmp[MR * NR];
+  for (int i = 0; i < MR; i++) {
+    for (int v = 0; v < NV; v++) S::store(tmp + i * NR + v * 8, acc[i][v]);
+  }
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      c[static_cast<size_t>(i) * ldc + j] += tmp[i * NR + j];
+    }
+  }
+}
+
+// C (m x n) += A (m x k) * B (k x n) with narrow packed inputs (the
+// caller has checked that A fits TA and B fits TB)
+template <typename TA, typename TB, int MR = default_mr,
+          int NR = default_nr>
+void int_gemm_narrow(int m, int n, int k, const int *a, int lda, const int *b,
+                     int ldb, int *c, int ldc,
+                     GemmBlocking blk = default_blocking<int>()) {
+  static_assert(sizeof(TA) == sizeof(TB), "A and B must pack alike");
+  constexpr int G = 4 / sizeof(TA);
+  blk.mc = std::max(MR, blk.mc / MR * MR);
+  blk.nc = std::max(NR, blk.nc / NR * NR);
+  blk.kc = std::max(G, blk.kc / G * G);
+
+  AlignedBuffer<TA> packed_a(
+      gemm_packed_size<MR>(std::min(blk.mc, m), blk.kc));
+  AlignedBuffer<TB> packed_b(
+      gemm_packed_size<NR>(std::min(blk.nc, n), blk.kc));
+
+  for (int jc = 0; jc < n; jc += blk.nc) {
+    int nc = std::min(blk.nc, n - jc);
+    for (int pc = 0; pc < k; pc += blk.kc) {
+      // Round the depth up to whole groups (the padding is zeroed)
+      int kc = std::min(blk.kc, k - pc);
+      int kc_padded = (kc + G - 1) / G * G;
+      int_gemm_pack_b<TB, NR>(kc_padded, nc, kc,
+                              b + static_cast<size_t>(pc) * ldb + jc, ldb,
+                              packed_b.data());
+      for (int ic = 0; ic < m; ic += blk.mc) {
+        int mc = std::min(blk.mc, m - ic);
+        int_gemm_pack_a<TA, MR>(mc, kc_padded, kc,
+                                a + static_cast<size_t>(ic) * lda + pc, lda,
+                                packed_a.data());
+        for (int jr = 0; jr < nc; jr += NR) {
+          for (int ir = 0; ir < mc; ir += MR) {
+            int_gemm_micro_kernel<TA, TB, MR, NR>(
+                kc_padded / G,
+                packed_a.data() + static_cast<size_t>(ir) * kc_padded,
+                packed_b.data() + static_cast<size_t>(jr) * kc_padded,
+                c + static_cast<size_t>(ic + ir) * ldc + jc + jr, ldc,
+                std::min(MR, mc - ir), std::min(NR, nc - jr));
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif
+
+// C (m x n) += A (m x k) * B (k x n) on the given path (which must be
+// valid for the inputs, see int_gemm_path)
+inline void int_gemm(IntGemmPath path, int m, int n, int k, const int *a,
+                     int lda, const int *b, int ldb, int *c, int ldc) {
+#ifdef __AVX2__
+  if (path == IntGemmPath::int8) {
+    int_gemm_narrow<uint8_t, int8_t>(m, n, k, a, lda, b, ldb, c, ldc);
+    return;
+  }
+  if (path == IntGemmPath::int16) {
+    int_gemm_narrow<int16_t, int16_t>(m, n, k, a, lda, b, ldb, c, ldc);
+    return;
+  }
+#else
+  (void)path;
+#endif
+  gemm<int>(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+// Range-check the inputs, then use the narrowest exact path (returned)
+inline IntGemmPath int_gemm(int m, int n, int k, const int *a, int lda,
+                            const int *b, int ldb, int *c, int ldc) {
+  IntGemmPath path = int_gemm_path(m, n, k, a, lda, b, ldb);
+  int_gemm(path, m, n, k, a, lda, b, ldb, c, ldc);
+  return path;
+}
+
+// Drop-in replacement for base_mmul (square N x N, C += A * B)
+inline void int_mmul(const int *a, const int *b, int *c, const int N) {
+  int_gemm(N, N, N, a, N, b, N, c, N);
+}
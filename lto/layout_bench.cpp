@@ -0,0 +1,115 @@
+// This program runs the baseline triple loop and a cache-blocked loop on
+// Matrix2D containers, with B in each layout (row-major B is base_mmul),
+// and the packed gemm on row-major containers
+// Build: g++ -O3 -march=native layout_bench.cpp base_mmul.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+#include "../common/verify.h"
+#include "layout_mmul.h"
+
+// Function prototypes
+void base_mmul(const int *a, const int *b, int *c, const int N);
+
+// Copy a matrix out to a plain row-major array (for checking)
+template <typename Layout>
+static std::vector<int> rowMajorCopy(const Matrix2D<int, Layout> &m) {
+  std::vector<int> v(m.rows() * m.cols());
+  for (size_t i = 0; i < m.rows(); i++) {
+    for (size_t j = 0; j < m.cols(); j++) v[i * m.cols() + j] = m(i, j);
+  }
+  return v;
+}
+
+// Run one of the multiplies on random N x N matrices, with A and C in
+// layout LA and B in layout LB
+template <typename LA, typename LB, typename F>
+static void mmulBench(benchmark::State &s, F mmul) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // Allocate for our matrices
+  Matrix2D<int, LA> a(N, N);
+  Matrix2D<int, LB> b(N, N);
+  Matrix2D<int, LA> c(N, N);
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      a(i, j) = rand() % 100;
+      b(i, j) = rand() % 100;
+    }
+  }
+
+  // Check the result before timing anything
+  mmul(a, b, c);
+  auto a_rows = rowMajorCopy(a), b_rows = rowMajorCopy(b);
+  auto c_rows = rowMajorCopy(c);
+  if (!verify_mmul(a_rows.data(), b_rows.data(), c_rows.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul(a, b, c);
+  }
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+
+// Our baseline on raw arrays
+static void baseline(benchmark::State &s) {
+  mmulBench<RowMajor, RowMajor>(
+      s, [](const auto &a, const auto &b, auto &c) {
+        base_mmul(a.data(), b.data(), c.data(), a.rows());
+      });
+}
+BENCHMARK(baseline)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+// The same loop through the container, with B in each layout
+template <typename LB>
+static void tripleLoop(benchmark::State &s) {
+  mmulBench<RowMajor, LB>(
+      s, [](const auto &a, const auto &b, auto &c) { mmul(a, b, c); });
+}
+BENCHMARK_TEMPLATE(tripleLoop, RowMajor)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tripleLoop, ColumnMajor)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tripleLoop, Tiled<>)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tripleLoop, Morton)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+// Cache-blocked loop, with every matrix in the same layout
+template <typename L>
+static void blockedLoop(benchmark::State &s) {
+  mmulBench<L, L>(s, [](const auto &a, const auto &b, auto &c) {
+    mmul_blocked(a, b, c);
+  });
+}
+BENCHMARK_TEMPLATE(blockedLoop, RowMajor)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(blockedLoop, Tiled<>)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(blockedLoop, Morton)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+// The packed gemm on row-major containers
+static void blockedGemm(benchmark::State &s) {
+  mmulBench<RowMajor, RowMajor>(s, [](const auto &a, const auto &b, auto &c) {
+    blocked_mmul(a, b, c);
+  });
+}
+BENCHMARK(blockedGemm)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
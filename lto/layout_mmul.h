@@ -0,0 +1,205 @@
+// Matrix multiplication (C += A * B) on Matrix2D containers, so the
+// layout of each matrix is part of its type:
+//   - mmul: the triple loop from base_mmul. With a row-major B the inner
+//     loop walks down a column of B (a new cache line every step). With a
+//     column-major, tiled or Morton B it doesn't.
+//   - mmul_blocked: the same loops over bs x bs blocks, so each block of
+//     A, B and C gets reused while it's in cache (the blocks of a tiled or
+//     Morton matrix are contiguous, so they don't conflict in the cache).
+//     The inner loop runs over the contiguous pieces of a row of B and C
+//     (see row_run in matrix2d.h) through plain pointers, so it vectorizes
+//     when those pieces are long (row-major). Square tiles and Morton
+//     matrices have their own overloads that work on whole contiguous
+//     blocks instead (a Morton row run is only 2 elements)
+//   - blocked_mmul: row-major containers can go straight to the packed
+//     gemm
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include "../common/matrix2d.h"
+#include "gemm.h"
+
+template <typename T, typename LA, typename LB, typename LC>
+inline void mmul(const Matrix2D<T, LA> &a, const Matrix2D<T, LB> &b,
+                 Matrix2D<T, LC> &c) {
+  // For every row...
+  for (size_t i = 0; i < c.rows(); i++) {
+    // For every col...
+    for (size_t j = 0; j < c.cols(); j++) {
+      // For each element in the row-col pair
+      T acc = c(i, j);
+      for (size_t k = 0; k < a.cols(); k++) acc += a(i, k) * b(k, j);
+      c(i, j) = acc;
+    }
+  }
+}
+
+template <typename T, typename LA, typename LB, typename LC>
+inline void mmul_blocked(const Matrix2D<T, LA> &a, const Matrix2D<T, LB> &b,
+                         Matrix2D<T, LC> &c, size_t bs = 64) {
+  const size_t m = c.rows(), n = c.cols(), depth = a.cols();
+  // Elements of a row that are contiguous in both B and C
+  constexpr size_t run = std::min(LB::row_run, LC::row_run);
+  for (size_t i0 = 0; i0 < m; i0 += bs) {
+    for (size_t k0 = 0; k0 < depth; k0 += bs) {
+      for (size_t j0 = 0; j0 < n; j0 += bs) {
+        // One block of C += one block of A * one block of B (i-k-j, so
+        // the inner loop runs along a row of B and C)
+        size_t i1 = std::min(i0 + bs, m);
+        size_t k1 = std::min(k0 + bs, depth);
+        size_t j1 = std::min(j0 + bs, n);
+        for (size_t i = i0; i < i1; i++) {
+          for (size_t k = k0; k < k1; k++) {
+            T a_ik = a(i, k);
+            for (size_t j = j0; j < j1;) {
+              size_t len = std::min(j1 - j, run - j % run);
+              T *c_row = &c(i, j);
+              const T *b_row = &b(k, j);
+              for (size_t t = 0; t < len; t++) c_row[t] += a_ik * b_row[t];
+              j += len;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// With square tiles everywhere, every tile of A, B and C is a contiguous
+// TS x TS block, so we multiply whole tiles with fixed-size loops the
+// compiler can unroll. Padding is zero, so edge tiles need no special
+// case (padded parts of C only ever get zeros added).
+template <typename T, int TS>
+inline void mmul_blocked(const Matrix2D<T, Tiled<TS, TS>> &a,
+                         const Matrix2D<T, Tiled<TS, TS>> &b,
+                         Matrix2D<T, Tiled<TS, TS>> &c, size_t bs = 64) {
+  // Everything in whole tiles
+  const size_t mt = (c.rows() + TS - 1) / TS;
+  const size_t nt = (c.cols() + TS - 1) / TS;
+  const size_t kt = (a.cols() + TS - 1) / TS;
+  const size_t bt = std::max<size_t>(bs / TS, 1);
+  for (size_t i0 = 0; i0 < mt; i0 += bt) {
+    for (size_t k0 = 0; k0 < kt; k0 += bt) {
+      for (size_t j0 = 0; j0 < nt; j0 += bt) {
+        for (size_t ti = i0; ti < std::min(i0 + bt, mt); ti++) {
+          for (size_t tk = k0; tk < std::min(k0 + bt, kt); tk++) {
+            const T *a_tile = &a(ti * TS, tk * TS);
+            for (size_t tj = j0; tj < std::min(j0 + bt, nt); tj++) {
+              const T *b_tile = &b(tk * TS, tj * TS);
+              T *c_tile = &c(ti * TS, tj * TS);
+              // C tile += A tile * B tile
+              for (int r = 0; r < TS; r++) {
+                for (int q = 0; q < TS; q++) {
+                  T a_rq = a_tile[r * TS + q];
+                  for (int t = 0; t < TS; t++) {
+                    c_tile[r * TS + t] += a_rq * b_tile[q * TS + t];
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Offsets inside an L x L Morton block (the column part; the row part is
+// the same shifted left by one), worked out at compile time
+template <int L>
+struct MortonLeafOffsets {
+  size_t off[L];
+  constexpr MortonLeafOffsets() : off() {
+    for (int t = 0; t < L; t++) {
+      for (int bit = 0; (t >> bit) != 0; bit++) {
+        off[t] |= size_t((t >> bit) & 1) << (2 * bit);
+      }
+    }
+  }
+};
+
+// C += A * B on one L x L Morton block of each. Every offset is a
+// constant once the loops unroll, and the blocks never overlap, so C
+// stays in registers instead of being reloaded after every store
+template <typename T, int L>
+inline void mmul_morton_leaf(const T *__restrict a, const T *__restrict b,
+                             T *__restrict c) {
+  constexpr MortonLeafOffsets<L> mo{};
+#pragma GCC unroll 8
+  for (int r = 0; r < L; r++) {
+#pragma GCC unroll 8
+    for (int q = 0; q < L; q++) {
+      T a_rq = a[(mo.off[r] << 1) | mo.off[q]];
+#pragma GCC unroll 8
+      for (int t = 0; t < L; t++) {
+        c[(mo.off[r] << 1) | mo.off[t]] +=
+            a_rq * b[(mo.off[q] << 1) | mo.off[t]];
+      }
+    }
+  }
+}
+
+// C += A * B on one s x s Morton block of each, with the block's top-left
+// corner at (i0, k0) in A, (k0, j0) in B and (i0, j0) in C. Every aligned
+// quadrant is contiguous (quadrants in the order top-left, top-right,
+// bottom-left, bottom-right), so we recurse on quadrants down to an
+// L x L leaf. Blocks that start past the edge of the matrix are all
+// padding.
+template <typename T, int L>
+inline void mmul_morton(const T *a, const T *b, T *c, size_t i0, size_t k0,
+                        size_t j0, size_t s, size_t m, size_t n,
+                        size_t depth) {
+  if (i0 >= m || k0 >= depth || j0 >= n) return;
+  if (s == L) {
+    mmul_morton_leaf<T, L>(a, b, c);
+    return;
+  }
+  const size_t h = s / 2, q = h * h;
+  for (size_t qi = 0; qi < 2; qi++) {
+    for (size_t qj = 0; qj < 2; qj++) {
+      for (size_t qk = 0; qk < 2; qk++) {
+        mmul_morton<T, L>(a + (2 * qi + qk) * q, b + (2 * qk + qj) * q,
+                          c + (2 * qi + qj) * q, i0 + qi * h, k0 + qk * h,
+                          j0 + qj * h, h, m, n, depth);
+      }
+    }
+  }
+}
+
+// With Morton everywhere, recurse on quadrants instead of blocking with
+// bs (the recursion blocks for every cache level at once). Padding is
+// zero, so partly padded leaves need no special case.
+template <typename T>
+inline void mmul_blocked(const Matrix2D<T, Morton> &a,
+                         const Matrix2D<T, Morton> &b,
+                         Matrix2D<T, Morton> &c, size_t bs = 64) {
+  (void)bs;
+  constexpr int L = 8;
+  const size_t m = c.rows(), n = c.cols(), depth = a.cols();
+  // Every matrix must hold whole leaves (storage is the padded square)
+  const size_t leaf = size_t(L) * L;
+  if (a.storage_size() < leaf || b.storage_size() < leaf ||
+      c.storage_size() < leaf) {
+    mmul(a, b, c);
+    return;
+  }
+  size_t s = L;
+  while (s < m || s < n || s < depth) s *= 2;
+  mmul_morton<T, L>(a.data(), b.data(), c.data(), 0, 0, 0, s, m, n, depth);
+}
+
+// Row-major containers are plain arrays with a stride, so they can use
+// the blocked gemm directly
+template <typename T>
+inline void blocked_mmul(const Matrix2D<T, RowMajor> &a,
+                         const Matrix2D<T, RowMajor> &b,
+                         Matrix2D<T, RowMajor> &c,
+                         GemmBlocking blk = default_blocking<T>()) {
+  gemm<T>(static_cast<int>(c.rows()), static_cast<int>(c.cols()),
+          static_cast<int>(a.cols()), a.data(),
+          static_cast<int>(a.layout().stride()), b.data(),
+          static_cast<int>(b.layout().stride()), c.data(),
+          static_cast<int>(c.layout().stride()), blk);
+}
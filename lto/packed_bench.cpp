@@ -0,0 +1,151 @@
+// This program compares multiplying by a B that is packed once up front
+// (PackedMatrix) against packing B on every call, for the same B over many
+// calls (like the weights of a layer). A has M rows, B is N x N.
+// Build: g++ -O3 -march=native packed_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "../common/verify.h"
+#include "packed_matrix.h"
+
+// Random matrix with values like the other lto benchmarks
+template <typename T>
+static std::vector<T> randomMatrix(int rows, int cols) {
+  std::vector<T> v(size_t(rows) * cols);
+  for (auto &x : v) x = rand() % 100;
+  return v;
+}
+
+// Items are multiply-adds
+static void setCounters(benchmark::State &s, int M, int N) {
+  s.SetItemsProcessed(int64_t(M) * N * N * s.iterations());
+}
+
+// Pack B on every call (what blocked_mmul does)
+template <typename T>
+static void perCallPack(benchmark::State &s) {
+  // Unpack the rows of A and the dimension of B
+  const int M = s.range(0);
+  const int N = 1 << s.range(1);
+  auto a = randomMatrix<T>(M, N);
+  auto b = randomMatrix<T>(N, N);
+  std::vector<T> c(size_t(M) * N);
+
+  // Check the result before timing anything
+  gemm<T>(M, N, N, a.data(), N, b.data(), N, c.data(), N);
+  if (!verify_gemm(M, N, N, a.data(), N, b.data(), N, c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    gemm<T>(M, N, N, a.data(), N, b.data(), N, c.data(), N);
+  }
+
+  setCounters(s, M, N);
+}
+
+// Pack B once, then only pack A on every call
+template <typename T>
+static void prePacked(benchmark::State &s) {
+  // Unpack the rows of A and the dimension of B
+  const int M = s.range(0);
+  const int N = 1 << s.range(1);
+  auto a = randomMatrix<T>(M, N);
+  auto b = randomMatrix<T>(N, N);
+  std::vector<T> c(size_t(M) * N);
+
+  // The one-time cost we are amortizing
+  auto start = std::chrono::steady_clock::now();
+  PackedMatrix<T> packed(N, N, b.data(), N);
+  std::chrono::duration<double, std::milli> pack_time =
+      std::chrono::steady_clock::now() - start;
+
+  // Check the result before timing anything
+  gemm<T>(M, a.data(), N, packed, c.data(), N);
+  if (!verify_gemm(M, N, N, a.data(), N, b.data(), N, c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    gemm<T>(M, a.data(), N, packed, c.data(), N);
+  }
+
+  setCounters(s, M, N);
+  s.counters["pack_ms"] = pack_time.count();
+}
+
+// Rows of A (a handful of rows is the inference case) by log2(N)
+static void PackArgs(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({{1, 8, 64, 512}, {8, 9, 10}});
+}
+
+BENCHMARK_TEMPLATE(perCallPack, int)->Apply(PackArgs);
+BENCHMARK_TEMPLATE(prePacked, int)->Apply(PackArgs);
+BENCHMARK_TEMPLATE(perCallPack, float)->Apply(PackArgs);
+BENCHMARK_TEMPLATE(prePacked, float)->Apply(PackArgs);
+
+// The lto baseline loop (square N x N, many calls with the same B)
+template <typename T>
+static void baselinePacked(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+  auto a = randomMatrix<T>(N, N);
+  auto b = randomMatrix<T>(N, N);
+  std::vector<T> c(size_t(N) * N);
+  PackedMatrix<T> packed(N, N, b.data(), N);
+
+  // Check the result before timing anything
+  packed_mmul(a.data(), packed, c.data(), N);
+  if (!verify_gemm(N, N, N, a.data(), N, b.data(), N, c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    packed_mmul(a.data(), packed, c.data(), N);
+  }
+
+  setCounters(s, N, N);
+}
+
+template <typename T>
+static void baselineBlocked(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+  auto a = randomMatrix<T>(N, N);
+  auto b = randomMatrix<T>(N, N);
+  std::vector<T> c(size_t(N) * N);
+
+  // Check the result before timing anything
+  blocked_mmul(a.data(), b.data(), c.data(), N);
+  if (!verify_gemm(N, N, N, a.data(), N, b.data(), N, c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    blocked_mmul(a.data(), b.data(), c.data(), N);
+  }
+
+  setCounters(s, N, N);
+}
+
+BENCHMARK_TEMPLATE(baselineBlocked, int)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(baselinePacked, int)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(baselineBlocked, float)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(baselinePacked, float)
+    ->DenseRange(8, 10)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+// A B operand packed once into the micro-kernel's panel layout, for when
+// the same B (e.g. a weight matrix) is multiplied many times. The normal
+// gemm re-packs B on every call, which costs as much as the multiply
+// itself when A only has a few rows.
+//
+// B is stored as KC x NC blocks (column blocks outer, depth blocks inner),
+// each exactly what gemm_pack_b would have produced, starting on a cache
+// line. The blocking is fixed when we pack, so multiplies use the same one.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <vector>
+#include "gemm.h"
+
+template <typename T, int NR = default_nr>
+class PackedMatrix {
+ public:
+  PackedMatrix() = default;
+
+  // Pack B (k x n, row-major with leading dimension ldb)
+  PackedMatrix(int k, int n, const T *b, int ldb,
+               GemmBlocking blk = default_blocking<T>()) {
+    pack(k, n, b, ldb, blk);
+  }
+
+  void pack(int k, int n, const T *b, int ldb,
+            GemmBlocking blk = default_blocking<T>()) {
+    // Keep the blocks a whole number of register tiles
+    blk.nc = std::max(NR, blk.nc / NR * NR);
+    blk.kc = std::max(1, blk.kc);
+    num_rows = k;
+    num_cols = n;
+    block_size = blk;
+
+    // Where each block starts (rounded up to a cache line)
+    constexpr size_t line = 64 / sizeof(T);
+    offsets.clear();
+    size_t total = 0;
+    for (int jc = 0; jc < n; jc += blk.nc) {
+      int nc = std::min(blk.nc, n - jc);
+      for (int pc = 0; pc < k; pc += blk.kc) {
+        int kc = std::min(blk.kc, k - pc);
+        offsets.push_back(total);
+        total += (gemm_packed_size<NR>(nc, kc) + line - 1) / line * line;
+      }
+    }
+    data.reserve(total);
+
+    for (int jc = 0; jc < n; jc += blk.nc) {
+      int nc = std::min(blk.nc, n - jc);
+      for (int pc = 0; pc < k; pc += blk.kc) {
+        int kc = std::min(blk.kc, k - pc);
+        gemm_pack_b<T, NR>(kc, nc, b + static_cast<size_t>(pc) * ldb + jc,
+                           ldb, mutable_block(pc, jc));
+      }
+    }
+  }
+
+  int rows() const { return num_rows; }
+  int cols() const { return num_cols; }
+  const GemmBlocking &blocking() const { return block_size; }
+
+  // The packed block that starts at row pc and column jc of B
+  const T *block(int pc, int jc) const {
+    return data.data() + offsets[block_index(pc, jc)];
+  }
+
+ private:
+  T *mutable_block(int pc, int jc) {
+    return data.data() + offsets[block_index(pc, jc)];
+  }
+  size_t block_index(int pc, int jc) const {
+    int k_blocks = (num_rows + block_size.kc - 1) / block_size.kc;
+    return static_cast<size_t>(jc / block_size.nc) * k_blocks +
+           pc / block_size.kc;
+  }
+
+  int num_rows = 0;
+  int num_cols = 0;
+  GemmBlocking block_size = default_blocking<T>();
+  AlignedBuffer<T> data;
+  std::vector<size_t> offsets;
+};
+
+// C (m x n) += A (m x k) * B, with B already packed (no packing of B here)
+template <typename T, int MR = default_mr, int NR = default_nr>
+void gemm(int m, const T *a, int lda, const PackedMatrix<T, NR> &b, T *c,
+          int ldc) {
+  GemmBlocking blk = b.blocking();
+  blk.mc = std::max(MR, blk.mc / MR * MR);
+  const int n = b.cols();
+  const int k = b.rows();
+
+  AlignedBuffer<T> packed_a(gemm_packed_size<MR>(std::min(blk.mc, m), blk.kc));
+
+  for (int jc = 0; jc < n; jc += blk.nc) {
+    int nc = std::min(blk.nc, n - jc);
+    for (int pc = 0; pc < k; pc += blk.kc) {
+      int kc = std::min(blk.kc, k - pc);
+      const T *packed_b = b.block(pc, jc);
+      for (int ic = 0; ic < m; ic += blk.mc) {
+        int mc = std::min(blk.mc, m - ic);
+        gemm_pack_a<T, MR>(mc, kc, a + static_cast<size_t>(ic) * lda + pc, lda,
+                           packed_a.data());
+        gemm_macro_kernel<T, MR, NR>(mc, nc, kc, packed_a.data(), packed_b,
+                                     c + static_cast<size_t>(ic) * ldc + jc,
+                                     ldc);
+      }
+    }
+  }
+}
+
+// Square N x N version (C += A * B), like base_mmul
+template <typename T>
+inline void packed_mmul(const T *a, const PackedMatrix<T> &b, T *c,
+                        const int N) {
+  gemm<T>(N, a, N, b, c, N);
+}
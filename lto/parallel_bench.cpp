@@ -0,0 +1,122 @@
+// This program benchmarks our parallel matrix multiplication across a
+// range of thread counts, with and without work stealing, and reports the
+// parallel efficiency against the single-threaded blocked version
+// Build: g++ -O3 -march=native parallel_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "../common/verify.h"
+#include "parallel_gemm.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Seconds for one call of f() (best of a few runs)
+template <typename F>
+static double timeOnce(F f) {
+  double best = 1e30;
+  for (int rep = 0; rep < 3; rep++) {
+    auto start = Clock::now();
+    f();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+template <typename T>
+static void parallelBench(benchmark::State &s, bool steal) {
+  // Unpack the matrix size and thread count
+  const int N = s.range(0);
+  const int threads = s.range(1);
+
+  // Allocate for our matrices
+  T *a = new T[N * N];
+  T *b = new T[N * N];
+  T *c = new T[N * N]();
+  for (int i = 0; i < N * N; i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Single-threaded time to compare against
+  double serial = timeOnce([&] { blocked_mmul(a, b, c, N); });
+
+  ThreadPool pool(threads);
+  ParallelGemmWorkspace<T> ws;
+
+  // Check the result before timing anything
+  std::fill(c, c + N * N, T(0));
+  parallel_mmul(pool, ws, a, b, c, N, steal);
+  if (!verify_mmul(a, b, c, N)) s.SkipWithError("Incorrect result");
+
+  // Region to profile
+  double elapsed = 0;
+  while (s.KeepRunning()) {
+    auto start = Clock::now();
+    parallel_mmul(pool, ws, a, b, c, N, steal);
+    elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Free our memory
+  delete[] a;
+  delete[] b;
+  delete[] c;
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+
+  // Speedup over one thread, divided by the number of threads
+  double parallel = elapsed / s.iterations();
+  s.counters["efficiency"] = serial / (parallel * threads);
+
+  // How much of the last run's work was stolen
+  int run = 0, stolen = 0;
+  for (int t = 0; t < threads; t++) {
+    run += ws.tiles_run[t];
+    stolen += ws.tiles_stolen[t];
+  }
+  s.counters["stolen_%"] = run ? 100.0 * stolen / run : 0.0;
+}
+
+// Sizes (not all multiples of anything nice) by thread counts
+static void ThreadArgs(benchmark::internal::Benchmark *b) {
+  int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int N : {500, 1000, 1024, 2000}) {
+    for (int t = 1; t < max_threads; t *= 2) b->Args({N, t});
+    b->Args({N, max_threads});
+  }
+}
+
+static void parallelInt(benchmark::State &s) { parallelBench<int>(s, true); }
+BENCHMARK(parallelInt)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void staticInt(benchmark::State &s) { parallelBench<int>(s, false); }
+BENCHMARK(staticInt)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void parallelFloat(benchmark::State &s) {
+  parallelBench<float>(s, true);
+}
+BENCHMARK(parallelFloat)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void staticFloat(benchmark::State &s) {
+  parallelBench<float>(s, false);
+}
+BENCHMARK(staticFloat)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
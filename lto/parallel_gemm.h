@@ -0,0 +1,185 @@
+// Multi-threaded version of our blocked matrix multiplication. For each
+// KC-deep slice, A and B are packed once (in parallel) into shared
+// buffers, and C is split into macro-tiles that workers pull from
+// work-stealing queues.
+//
+// Tiles are numbered column-panel first, so neighbouring tiles share the
+// same packed B panel. Each worker starts with a contiguous range of tiles
+// and takes them from the front (staying on the panel it already has in
+// cache). An idle worker steals from the back of its neighbours' ranges,
+// which are the tiles closest to its own.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "../common/thread_pool.h"
+#include "gemm.h"
+
+// Columns of C per macro-tile (a multiple of every NR we use)
+constexpr int parallel_tile_cols = 256;
+
+// A range of tile indices [begin, end) that the owner pops from the front
+// and thieves pop from the back (both ends live in one 64-bit word so a
+// single CAS updates them together)
+struct alignas(64) TileQueue {
+  std::atomic<uint64_t> range{0};
+
+  static uint64_t pack(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+  }
+
+  void reset(uint32_t begin, uint32_t end) {
+    range.store(pack(begin, end), std::memory_order_relaxed);
+  }
+
+  // Owner side (returns -1 when empty)
+  int pop_front() {
+    uint64_t r = range.load(std::memory_order_relaxed);
+    while (true) {
+      uint32_t begin = r >> 32;
+      uint32_t end = static_cast<uint32_t>(r);
+      if (begin >= end) return -1;
+      if (range.compare_exchange_weak(r, pack(begin + 1, end),
+                                      std::memory_order_acq_rel)) {
+        return begin;
+      }
+    }
+  }
+
+  // Thief side (returns -1 when empty)
+  int steal_back() {
+    uint64_t r = range.load(std::memory_order_relaxed);
+    while (true) {
+      uint32_t begin = r >> 32;
+      uint32_t end = static_cast<uint32_t>(r);
+      if (begin >= end) return -1;
+      if (range.compare_exchange_weak(r, pack(begin, end - 1),
+                                      std::memory_order_acq_rel)) {
+        return end - 1;
+      }
+    }
+  }
+};
+
+// Shared state for one parallel multiply (reused across calls)
+template <typename T>
+struct ParallelGemmWorkspace {
+  AlignedBuffer<T> packed_a;
+  AlignedBuffer<T> packed_b;
+  std::vector<TileQueue> queues;
+  std::vector<int> tiles_run;  // Tiles each worker ran (for stats)
+  std::vector<int> tiles_stolen;
+};
+
+// C (m x n) += A (m x k) * B (k x n) using every worker in the pool. With
+// steal = false each worker only runs its own range (a static split).
+template <typename T, int MR = default_mr, int NR = default_nr>
+void parallel_gemm(ThreadPool &pool, ParallelGemmWorkspace<T> &ws, int m,
+                   int n, int k, const T *a, int lda, const T *b, int ldb,
+                   T *c, int ldc, GemmBlocking blk = default_blocking<T>(),
+                   bool steal = true) {
+  static_assert(parallel_tile_cols % NR == 0, "tiles must be whole slivers");
+  const int threads = pool.size();
+  blk.mc = std::max(MR, blk.mc / MR * MR);
+  blk.kc = std::max(1, blk.kc);
+  const int kc_max = std::min(blk.kc, k);
+
+  // Everything for one KC slice gets packed up front
+  ws.packed_a.reserve(gemm_packed_size<MR>(m, kc_max));
+  ws.packed_b.reserve(gemm_packed_size<NR>(n, kc_max));
+  ws.queues = std::vector<TileQueue>(threads);
+  ws.tiles_run.assign(threads, 0);
+  ws.tiles_stolen.assign(threads, 0);
+
+  // Tile t covers rows (t % tile_rows) and columns (t / tile_rows)
+  const int tile_rows = (m + blk.mc - 1) / blk.mc;
+  const int tile_cols = (n + parallel_tile_cols - 1) / parallel_tile_cols;
+  const int num_tiles = tile_rows * tile_cols;
+  const int a_slivers = (m + MR - 1) / MR;
+  const int b_slivers = (n + NR - 1) / NR;
+
+  for (int pc = 0; pc < k; pc += blk.kc) {
+    const int kc = std::min(blk.kc, k - pc);
+    T *packed_a = ws.packed_a.data();
+    T *packed_b = ws.packed_b.data();
+
+    // Pack this slice of A and B (each worker takes a range of slivers)
+    pool.run([&](int id) {
+      auto as = split_range(a_slivers, threads, id);
+      if (as.first < as.second) {
+        int row = as.first * MR;
+        int rows = std::min(m, as.second * MR) - row;
+        gemm_pack_a<T, MR>(rows, kc,
+                           a + static_cast<size_t>(row) * lda + pc, lda,
+                           packed_a + static_cast<size_t>(row) * kc);
+      }
+      auto bs = split_range(b_slivers, threads, id);
+      if (bs.first < bs.second) {
+        int col = bs.first * NR;
+        int cols = std::min(n, bs.second * NR) - col;
+        gemm_pack_b<T, NR>(kc, cols,
+                           b + static_cast<size_t>(pc) * ldb + col, ldb,
+                           packed_b + static_cast<size_t>(col) * kc);
+      }
+    });
+
+    // Hand out contiguous ranges of tiles
+    for (int t = 0; t < threads; t++) {
+      auto r = split_range(num_tiles, threads, t);
+      ws.queues[t].reset(r.first, r.second);
+    }
+
+    // Multiply
+    pool.run([&](int id) {
+      auto run_tile = [&](int t) {
+        int ic = (t % tile_rows) * blk.mc;
+        int jc = (t / tile_rows) * parallel_tile_cols;
+        int mc = std::min(blk.mc, m - ic);
+        int nc = std::min(parallel_tile_cols, n - jc);
+        gemm_macro_kernel<T, MR, NR>(
+            mc, nc, kc, packed_a + static_cast<size_t>(ic) * kc,
+            packed_b + static_cast<size_t>(jc) * kc,
+            c + static_cast<size_t>(ic) * ldc + jc, ldc);
+      };
+
+      // Our own tiles first (counted locally, since the workers' slots of
+      // the stats share a cache line)
+      int t;
+      int run = 0;
+      int stolen = 0;
+      while ((t = ws.queues[id].pop_front()) >= 0) {
+        run_tile(t);
+        run++;
+      }
+
+      // Then steal, nearest neighbours first
+      for (int d = 1; steal && d < threads; d++) {
+        TileQueue &victim = ws.queues[(id + d) % threads];
+        while ((t = victim.steal_back()) >= 0) {
+          run_tile(t);
+          stolen++;
+        }
+      }
+      ws.tiles_run[id] += run + stolen;
+      ws.tiles_stolen[id] += stolen;
+    });
+  }
+}
+
+// Square N x N versions (C += A * B), like base_mmul
+inline void parallel_mmul(ThreadPool &pool, ParallelGemmWorkspace<int> &ws,
+                          const int *a, const int *b, int *c, const int N,
+                          bool steal = true) {
+  parallel_gemm<int>(pool, ws, N, N, N, a, N, b, N, c, N,
+                     default_blocking<int>(), steal);
+}
+
+inline void parallel_mmul(ThreadPool &pool, ParallelGemmWorkspace<float> &ws,
+                          const float *a, const float *b, float *c,
+                          const int N, bool steal = true) {
+  parallel_gemm<float>(pool, ws, N, N, N, a, N, b, N, c, N,
+                       default_blocking<float>(), steal);
+}
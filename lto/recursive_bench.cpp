@@ -0,0 +1,107 @@
+// This program compares the cache-oblivious recursive multiply and
+// Strassen-Winograd (at a few cutoffs) against the blocked multiply for
+// large matrices (up to N = 2^13). Every result is checked first (with
+// Freivalds' algorithm for large N, where a reference multiply would take
+// hours)
+// Build: g++ -O3 -march=native recursive_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+#include "../common/verify.h"
+#include "recursive_mmul.h"
+
+// Strassen adds a little rounding error per level
+static VerifyOptions verifyOptions() {
+  VerifyOptions opt;
+  opt.tolerance = 1e-4;
+  return opt;
+}
+
+// Run one of the multiplies on random N x N matrices
+template <typename T, typename F>
+static void mmulBench(benchmark::State &s, F mmul) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // Allocate for our matrices
+  T *a = new T[size_t(N) * N];
+  T *b = new T[size_t(N) * N];
+  T *c = new T[size_t(N) * N]();
+  for (size_t i = 0; i < size_t(N) * N; i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Make sure we get the right answer before timing anything
+  mmul(a, b, c, N);
+  if (!verify_mmul(a, b, c, N, verifyOptions())) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul(a, b, c, N);
+  }
+
+  // Free our memory
+  delete[] a;
+  delete[] b;
+  delete[] c;
+
+  // One multiply-add per item (of the classical algorithm, so Strassen
+  // shows up as a higher rate)
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+
+// Strassen-Winograd with the cutoff from the second argument
+template <typename T>
+static void strassenBench(benchmark::State &s) {
+  const int cutoff = s.range(1);
+  mmulBench<T>(s, [cutoff](const T *a, const T *b, T *c, int N) {
+    strassen<T>(N, a, N, b, N, c, N, cutoff);
+  });
+  s.counters["scratch_MB"] =
+      strassen_scratch_size(1 << s.range(0), cutoff) * sizeof(T) / 1e6;
+}
+
+static void recursive(benchmark::State &s) {
+  mmulBench<int>(s, [](const int *a, const int *b, int *c, int N) {
+    recursive_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(recursive)->DenseRange(8, 13)->Unit(benchmark::kMillisecond);
+
+static void blocked(benchmark::State &s) {
+  mmulBench<int>(s, [](const int *a, const int *b, int *c, int N) {
+    blocked_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(blocked)->DenseRange(8, 13)->Unit(benchmark::kMillisecond);
+
+static void strassenInt(benchmark::State &s) { strassenBench<int>(s); }
+BENCHMARK(strassenInt)
+    ->ArgsProduct({benchmark::CreateDenseRange(8, 13, 1), {256, 512, 1024}})
+    ->Unit(benchmark::kMillisecond);
+
+static void recursiveFloat(benchmark::State &s) {
+  mmulBench<float>(s, [](const float *a, const float *b, float *c, int N) {
+    recursive_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(recursiveFloat)->DenseRange(8, 13)->Unit(benchmark::kMillisecond);
+
+static void blockedFloat(benchmark::State &s) {
+  mmulBench<float>(s, [](const float *a, const float *b, float *c, int N) {
+    blocked_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(blockedFloat)->DenseRange(8, 13)->Unit(benchmark::kMillisecond);
+
+static void strassenFloat(benchmark::State &s) { strassenBench<float>(s); }
+BENCHMARK(strassenFloat)
+    ->ArgsProduct({benchmark::CreateDenseRange(8, 13, 1), {256, 512, 1024}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,223 @@
+// Matrix multiplication for large N (C += A * B, row-major):
+//   - recursive_mmul: cache-oblivious divide and conquer. The largest
+//     dimension is halved until the sub-problem fits in cache, so every
+//     cache level gets used without knowing its size
+//   - strassen_mmul: Strassen-Winograd (7 half-size products instead of 8)
+//     down to a cutoff, then the blocked gemm. Fewer flops, but each level
+//     streams 15 matrix additions through memory and needs scratch space
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include "gemm.h"
+
+// Largest dimension of a base case for the recursive multiply
+constexpr int default_recursive_base = 64;
+
+// Smallest dimension we still split with Strassen-Winograd
+constexpr int default_strassen_cutoff = 512;
+
+// Recursive (cache-oblivious) --------------------------------------------
+
+// C[m x n] += A[m x k] * B[k x n] for blocks that fit in cache. The i-k-j
+// order streams rows of B and C, so the inner loop vectorizes
+template <typename T>
+inline void recursive_base(int m, int n, int k, const T *a, int lda,
+                           const T *b, int ldb, T *c, int ldc) {
+  for (int i = 0; i < m; i++) {
+    T *c_row = c + static_cast<size_t>(i) * ldc;
+    for (int p = 0; p < k; p++) {
+      T a_ip = a[static_cast<size_t>(i) * lda + p];
+      const T *b_row = b + static_cast<size_t>(p) * ldb;
+      for (int j = 0; j < n; j++) c_row[j] += a_ip * b_row[j];
+    }
+  }
+}
+
+// C (m x n) += A (m x k) * B (k x n), halving the largest dimension until
+// all three are at most base
+template <typename T>
+void recursive_mmul(int m, int n, int k, const T *a, int lda, const T *b,
+                    int ldb, T *c, int ldc,
+                    int base = default_recursive_base) {
+  if (m <= base && n <= base && k <= base) {
+    recursive_base(m, n, k, a, lda, b, ldb, c, ldc);
+    return;
+  }
+
+  if (m >= n && m >= k) {
+    // Split the rows of A and C
+    int h = m / 2;
+    recursive_mmul(h, n, k, a, lda, b, ldb, c, ldc, base);
+    recursive_mmul(m - h, n, k, a + static_cast<size_t>(h) * lda, lda, b, ldb,
+                   c + static_cast<size_t>(h) * ldc, ldc, base);
+  } else if (n >= k) {
+    // Split the columns of B and C
+    int h = n / 2;
+    recursive_mmul(m, h, k, a, lda, b, ldb, c, ldc, base);
+    recursive_mmul(m, n - h, k, a, lda, b + h, ldb, c + h, ldc, base);
+  } else {
+    // Split the shared dimension (both halves accumulate into C)
+    int h = k / 2;
+    recursive_mmul(m, n, h, a, lda, b, ldb, c, ldc, base);
+    recursive_mmul(m, n, k - h, a + h, lda, b + static_cast<size_t>(h) * ldb,
+                   ldb, c, ldc, base);
+  }
+}
+
+// Strassen-Winograd -------------------------------------------------------
+
+// Element-wise helpers on h x h blocks with leading dimensions
+// d = x + y
+template <typename T>
+inline void block_add(int h, const T *x, int ldx, const T *y, int ldy, T *d,
+                      int ldd) {
+  for (int i = 0; i < h; i++) {
+    const T *xr = x + static_cast<size_t>(i) * ldx;
+    const T *yr = y + static_cast<size_t>(i) * ldy;
+    T *dr = d + static_cast<size_t>(i) * ldd;
+    for (int j = 0; j < h; j++) dr[j] = xr[j] + yr[j];
+  }
+}
+
+// d = x - y
+template <typename T>
+inline void block_sub(int h, const T *x, int ldx, const T *y, int ldy, T *d,
+                      int ldd) {
+  for (int i = 0; i < h; i++) {
+    const T *xr = x + static_cast<size_t>(i) * ldx;
+    const T *yr = y + static_cast<size_t>(i) * ldy;
+    T *dr = d + static_cast<size_t>(i) * ldd;
+    for (int j = 0; j < h; j++) dr[j] = xr[j] - yr[j];
+  }
+}
+
+// d += x
+template <typename T>
+inline void block_acc(int h, const T *x, int ldx, T *d, int ldd) {
+  for (int i = 0; i < h; i++) {
+    const T *xr = x + static_cast<size_t>(i) * ldx;
+    T *dr = d + static_cast<size_t>(i) * ldd;
+    for (int j = 0; j < h; j++) dr[j] += xr[j];
+  }
+}
+
+// Scratch needed by strassen_level for an n x n problem: three h x h
+// temporaries per level (a geometric series, so at most n * n in total)
+inline size_t strassen_scratch_size(int n, int cutoff) {
+  size_t total = 0;
+  while (n > cutoff && n % 2 == 0) {
+    n /= 2;
+    total += 3 * static_cast<size_t>(n) * n;
+  }
+  return total;
+}
+
+// C (n x n) += A (n x n) * B (n x n) with one Strassen-Winograd level,
+// recursing on the 7 half-size products. Odd sizes (and anything at or
+// below the cutoff) go to the blocked gemm.
+//
+// With quadrants A11..A22 / B11..B22, the Winograd form is:
+//   S1 = A21 + A22   S2 = S1 - A11   S3 = A11 - A21   S4 = A12 - S2
+//   T1 = B12 - B11   T2 = B22 - T1   T3 = B22 - B12   T4 = T2 - B21
+//   P1 = A11 B11  P2 = A12 B21  P3 = S4 B22  P4 = A22 T4
+//   P5 = S1 T1    P6 = S2 T2    P7 = S3 T3
+//   C11 += P1 + P2          C12 += P1 + P6 + P5 + P3
+//   C21 += P1 + P6 + P7 - P4  C22 += P1 + P6 + P7 + P5
+// Products go straight into C where possible, so we only need three
+// temporaries (X for A sums, Y for B sums, P for shared products)
+template <typename T>
+void strassen_level(int n, const T *a, int lda, const T *b, int ldb, T *c,
+                    int ldc, int cutoff, T *scratch) {
+  if (n <= cutoff || n % 2) {
+    gemm<T>(n, n, n, a, lda, b, ldb, c, ldc);
+    return;
+  }
+
+  const int h = n / 2;
+  const size_t hh = static_cast<size_t>(h) * h;
+  const T *a11 = a, *a12 = a + h;
+  const T *a21 = a + static_cast<size_t>(h) * lda, *a22 = a21 + h;
+  const T *b11 = b, *b12 = b + h;
+  const T *b21 = b + static_cast<size_t>(h) * ldb, *b22 = b21 + h;
+  T *c11 = c, *c12 = c + h;
+  T *c21 = c + static_cast<size_t>(h) * ldc, *c22 = c21 + h;
+  T *x = scratch, *y = scratch + hh, *p = scratch + 2 * hh;
+  T *next = scratch + 3 * hh;
+
+  // Multiply two h x h blocks into the destination (+=)
+  auto mul = [&](const T *l, int ldl, const T *r, int ldr, T *d, int ldd) {
+    strassen_level(h, l, ldl, r, ldr, d, ldd, cutoff, next);
+  };
+  auto clear = [&](T *d) { std::fill(d, d + hh, T(0)); };
+
+  // C11 += P1 + P2 (P1 is kept for the other quadrants)
+  clear(p);
+  mul(a11, lda, b11, ldb, p, h);
+  block_acc(h, p, h, c11, ldc);
+  mul(a12, lda, b21, ldb, c11, ldc);
+
+  // P = P1 + P6 goes to C12, C21 and C22
+  block_add(h, a21, lda, a22, lda, x, h);  // S1
+  block_sub(h, x, h, a11, lda, x, h);      // S2
+  block_sub(h, b22, ldb, b12, ldb, y, h);  // T3
+  block_add(h, y, h, b11, ldb, y, h);      // T2 = B22 - (B12 - B11)
+  mul(x, h, y, h, p, h);
+  block_acc(h, p, h, c12, ldc);
+  block_acc(h, p, h, c21, ldc);
+  block_acc(h, p, h, c22, ldc);
+
+  // C21 -= P4, with -T4 = B21 - T2
+  block_sub(h, b21, ldb, y, h, y, h);
+  mul(a22, lda, y, h, c21, ldc);
+
+  // C12 += P3, with S4 = A12 - S2
+  block_sub(h, a12, lda, x, h, x, h);
+  mul(x, h, b22, ldb, c12, ldc);
+
+  // P7 goes to C21 and C22
+  block_sub(h, a11, lda, a21, lda, x, h);  // S3
+  block_sub(h, b22, ldb, b12, ldb, y, h);  // T3
+  clear(p);
+  mul(x, h, y, h, p, h);
+  block_acc(h, p, h, c21, ldc);
+  block_acc(h, p, h, c22, ldc);
+
+  // P5 goes to C12 and C22
+  block_add(h, a21, lda, a22, lda, x, h);  // S1
+  block_sub(h, b12, ldb, b11, ldb, y, h);  // T1
+  clear(p);
+  mul(x, h, y, h, p, h);
+  block_acc(h, p, h, c12, ldc);
+  block_acc(h, p, h, c22, ldc);
+}
+
+// Strassen-Winograd down to cutoff (owns its scratch space)
+template <typename T>
+void strassen(int n, const T *a, int lda, const T *b, int ldb, T *c, int ldc,
+              int cutoff = default_strassen_cutoff) {
+  cutoff = std::max(1, cutoff);
+  AlignedBuffer<T> scratch(strassen_scratch_size(n, cutoff));
+  strassen_level(n, a, lda, b, ldb, c, ldc, cutoff, scratch.data());
+}
+
+// Drop-in replacements for base_mmul (square N x N, C += A * B)
+inline void recursive_mmul(const int *a, const int *b, int *c, const int N) {
+  recursive_mmul<int>(N, N, N, a, N, b, N, c, N);
+}
+
+inline void recursive_mmul(const float *a, const float *b, float *c,
+                           const int N) {
+  recursive_mmul<float>(N, N, N, a, N, b, N, c, N);
+}
+
+inline void strassen_mmul(const int *a, const int *b, int *c, const int N) {
+  strassen<int>(N, a, N, b, N, c, N);
+}
+
+inline void strassen_mmul(const float *a, const float *b, float *c,
+                          const int N) {
+  strassen<float>(N, a, N, b, N, c, N);
+}
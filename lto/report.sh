@@ -0,0 +1,68 @@
+#!/bin/sh
+# Puts the real time of every benchmark side by side for each build variant
+# (plus the speedup of each variant over the multi-TU build)
+# Usage: report.sh <results dir> <variant>...
+# By: Nick from CoffeeBeforeArch
+
+dir=$1
+shift
+
+# Also save the table as a CSV next to the results
+awk -F, -v variants="$*" -v csv="$dir/report.csv" '
+  BEGIN { nv = split(variants, vs, " ") }
+  # Google Benchmark CSV: name,iterations,real_time,cpu_time,time_unit,...
+  FNR == 1 {
+    file = FILENAME
+    sub(/.*\//, "", file)
+    sub(/\.csv$/, "", file)
+    variant = file
+    sub(/^[^.]*\./, "", variant)
+    next
+  }
+  $1 ~ /^"/ {
+    name = $1
+    gsub(/"/, "", name)
+    if (!(name in seen)) {
+      seen[name] = 1
+      order[++n] = name
+    }
+    time[name, variant] = $3
+    unit[name] = $5
+  }
+  END {
+    printf "%-40s %5s", "benchmark", "unit"
+    header = "benchmark,unit"
+    for (i = 1; i <= nv; i++) {
+      printf " %11s", vs[i]
+      header = header "," vs[i]
+    }
+    for (i = 1; i <= nv; i++) {
+      if (vs[i] != "multi") {
+        printf " %11s", vs[i] "/x"
+        header = header "," vs[i] "_speedup"
+      }
+    }
+    printf "\n"
+    print header > csv
+    for (r = 1; r <= n; r++) {
+      name = order[r]
+      printf "%-40s %5s", name, unit[name]
+      line = name "," unit[name]
+      for (i = 1; i <= nv; i++) {
+        t = time[name, vs[i]]
+        printf " %11.3f", t
+        line = line "," t
+      }
+      base = time[name, "multi"]
+      for (i = 1; i <= nv; i++) {
+        if (vs[i] == "multi") continue
+        t = time[name, vs[i]]
+        s = (t > 0 && base > 0) ? base / t : 0
+        printf " %11.2f", s
+        line = line "," s
+      }
+      printf "\n"
+      print line > csv
+    }
+  }
+' "$dir"/*.csv
@@ -0,0 +1,97 @@
+// This program benchmarks batches of small (4x4, 8x8, 16x16) matrix
+// multiplications, where the per-call overhead of a runtime-sized kernel
+// dominates
+// Build: g++ -O3 -march=native small_bench.cpp base_mmul.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+#include "../common/verify.h"
+#include "small_mmul.h"
+
+// Number of independent products per batch
+const int batch = 1 << 12;
+
+// Random batch of N x N matrices (one after another in memory)
+static std::vector<int> randomBatch(int N) {
+  std::vector<int> v(size_t(batch) * N * N);
+  for (auto &x : v) x = rand() % 100;
+  return v;
+}
+
+// Items are multiply-adds
+static void setCounters(benchmark::State &s, int N) {
+  s.SetItemsProcessed(int64_t(batch) * N * N * N * s.iterations());
+}
+
+// Every product in the batch (c has to start out zeroed, since the
+// kernels add into it)
+static bool verifyBatch(const std::vector<int> &a, const std::vector<int> &b,
+                        const std::vector<int> &c, int N) {
+  ThreadPool pool(1);
+  for (int i = 0; i < batch; i++) {
+    size_t off = size_t(i) * N * N;
+    if (!verify_gemm_exact(pool, N, N, N, &a[off], N, &b[off], N, &c[off],
+                           N)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Times mmul(a, b, c) over a batch of N x N products (checked first)
+template <typename F>
+static void runBatch(benchmark::State &s, int N, F mmul) {
+  auto a = randomBatch(N);
+  auto b = randomBatch(N);
+  std::vector<int> c(a.size());
+  auto pass = [&] {
+    for (int i = 0; i < batch; i++) {
+      size_t off = size_t(i) * N * N;
+      mmul(&a[off], &b[off], &c[off]);
+    }
+  };
+
+  // Check the results before timing anything
+  pass();
+  if (!verifyBatch(a, b, c, N)) s.SkipWithError("Incorrect result");
+
+  while (s.KeepRunning()) {
+    pass();
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, N);
+}
+
+// base_mmul from another translation unit (N only known at runtime)
+static void batchBaseline(benchmark::State &s) {
+  const int N = s.range(0);
+  runBatch(s, N, [N](const int *a, const int *b, int *c) {
+    base_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(batchBaseline)->RangeMultiplier(2)->Range(4, 16);
+
+// Runtime dispatch to a compiled specialization
+static void batchDispatch(benchmark::State &s) {
+  const int N = s.range(0);
+  runBatch(s, N, [N](const int *a, const int *b, int *c) {
+    dispatch_mmul(a, b, c, N);
+  });
+}
+BENCHMARK(batchDispatch)->RangeMultiplier(2)->Range(4, 16);
+
+// Calling the specialization directly (the best we can hope for)
+template <int N>
+static void batchTemplate(benchmark::State &s) {
+  runBatch(s, N, [](const int *a, const int *b, int *c) {
+    mmul<int, N, N, N>(a, b, c);
+  });
+}
+BENCHMARK_TEMPLATE(batchTemplate, 4);
+BENCHMARK_TEMPLATE(batchTemplate, 8);
+BENCHMARK_TEMPLATE(batchTemplate, 16);
+
+BENCHMARK_MAIN();
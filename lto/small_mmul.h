@@ -0,0 +1,101 @@
+// Fully unrolled matrix multiplication for small matrices whose size is
+// known at compile time (C[M x N] += A[M x K] * B[K x N], row-major). With
+// constexpr dimensions the compiler can unroll every loop, keep the rows
+// of C in registers, and pick the exact SIMD shape for N.
+//
+// small_mmul() is a runtime dispatcher: if N is one of the sizes we
+// compiled a specialization for it runs that, otherwise it returns false
+// so the caller can fall back to the general kernel.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <cstring>
+#include "gemm.h"
+
+// Our baseline (from base_mmul.cpp)
+void base_mmul(const int *a, const int *b, int *c, const int N);
+
+// Generic version (for rows that don't fit a vector type)
+template <typename T, int M, int N, int K>
+inline void mmul_unrolled(const T *a, const T *b, T *c) {
+#pragma GCC unroll 16
+  for (int i = 0; i < M; i++) {
+    T acc[N];
+#pragma GCC unroll 16
+    for (int j = 0; j < N; j++) acc[j] = c[i * N + j];
+#pragma GCC unroll 16
+    for (int k = 0; k < K; k++) {
+#pragma GCC unroll 16
+      for (int j = 0; j < N; j++) acc[j] += a[i * K + k] * b[k * N + j];
+    }
+#pragma GCC unroll 16
+    for (int j = 0; j < N; j++) c[i * N + j] = acc[j];
+  }
+}
+
+// SIMD version using GCC vector extensions: a whole row of C is one
+// vector (split into as many registers as the target needs), and every A
+// element is broadcast against a row of B
+template <typename T, int M, int N, int K>
+inline void mmul_rows(const T *a, const T *b, T *c) {
+  typedef T row __attribute__((vector_size(N * sizeof(T))));
+#pragma GCC unroll 16
+  for (int i = 0; i < M; i++) {
+    row acc;
+    std::memcpy(&acc, c + i * N, sizeof(row));
+#pragma GCC unroll 16
+    for (int k = 0; k < K; k++) {
+      row b_row;
+      std::memcpy(&b_row, b + k * N, sizeof(row));
+      acc += a[i * K + k] * b_row;
+    }
+    std::memcpy(c + i * N, &acc, sizeof(row));
+  }
+}
+
+// Vector extensions need the row to be a power of two bytes
+template <typename T, int N>
+constexpr bool row_is_vector() {
+  constexpr int bytes = N * sizeof(T);
+  return bytes >= 16 && (bytes & (bytes - 1)) == 0;
+}
+
+// C[M x N] += A[M x K] * B[K x N]
+template <typename T, int M, int N, int K>
+inline void mmul(const T *a, const T *b, T *c) {
+  if constexpr (row_is_vector<T, N>()) {
+    mmul_rows<T, M, N, K>(a, b, c);
+  } else {
+    mmul_unrolled<T, M, N, K>(a, b, c);
+  }
+}
+
+// Square sizes we compile specializations for
+template <typename T, int... Sizes>
+struct SmallMmulSizes {
+  // Runs the N x N specialization (returns false if we don't have one)
+  static bool run(const T *a, const T *b, T *c, int N) {
+    return ((N == Sizes && (mmul<T, Sizes, Sizes, Sizes>(a, b, c), true)) ||
+            ...);
+  }
+};
+template <typename T>
+using small_mmul_sizes = SmallMmulSizes<T, 2, 4, 8, 16>;
+
+// Dispatch an N x N multiply to a specialization if we have one
+template <typename T>
+inline bool small_mmul(const T *a, const T *b, T *c, const int N) {
+  return small_mmul_sizes<T>::run(a, b, c, N);
+}
+
+// Drop-in replacements for base_mmul that use the specializations when
+// they can (and the general kernels when they can't)
+inline void dispatch_mmul(const int *a, const int *b, int *c, const int N) {
+  if (!small_mmul(a, b, c, N)) base_mmul(a, b, c, N);
+}
+
+inline void dispatch_mmul(const float *a, const float *b, float *c,
+                          const int N) {
+  if (!small_mmul(a, b, c, N)) blocked_mmul(a, b, c, N);
+}
@@ -0,0 +1,115 @@
+// This program compares the blocked multiply with its default block sizes
+// against the autotuned ones for this machine. Pass --autotune to run the
+// search (and update the cache file) even if this CPU is already in it.
+// Usage: ./tune_bench [--autotune] [--tune_size=<N>] [benchmark flags]
+// Build: g++ -O3 -march=native tune_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../common/verify.h"
+#include "autotune.h"
+
+// Run one of the multiplies on random N x N matrices
+template <typename T, void (*mmul)(const T *, const T *, T *, const int)>
+static void mmulBench(benchmark::State &s) {
+  // Unpack the dimension of the square matrix
+  const int N = 1 << s.range(0);
+
+  // Allocate for our matrices
+  std::vector<T> a(size_t(N) * N);
+  std::vector<T> b(a.size());
+  std::vector<T> c(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = rand() % 100;
+    b[i] = rand() % 100;
+  }
+
+  // Check the result before timing anything
+  mmul(a.data(), b.data(), c.data(), N);
+  if (!verify_mmul(a.data(), b.data(), c.data(), N)) {
+    s.SkipWithError("Incorrect result");
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    mmul(a.data(), b.data(), c.data(), N);
+  }
+
+  // One multiply-add per item
+  s.SetItemsProcessed(int64_t(N) * N * N * s.iterations());
+}
+
+static void blocked(benchmark::State &s) {
+  mmulBench<int, blocked_mmul>(s);
+}
+BENCHMARK(blocked)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void tuned(benchmark::State &s) { mmulBench<int, tuned_mmul>(s); }
+BENCHMARK(tuned)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void blockedFloat(benchmark::State &s) {
+  mmulBench<float, blocked_mmul>(s);
+}
+BENCHMARK(blockedFloat)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+static void tunedFloat(benchmark::State &s) {
+  mmulBench<float, tuned_mmul>(s);
+}
+BENCHMARK(tunedFloat)->DenseRange(8, 10)->Unit(benchmark::kMillisecond);
+
+// Search and save the tuning for one type
+template <typename T>
+static void retune(int N) {
+  printf("Tuning %s gemm on %d x %d...\n", tuning_type_name<T>(), N, N);
+  GemmTuning t = autotune_gemm<T>(N);
+  if (!save_gemm_tuning<T>(t)) {
+    printf("  Could not write %s\n", tuning_cache_path().c_str());
+  }
+}
+
+template <typename T>
+static void printTuning() {
+  const GemmTuning &t = gemm_tuning<T>();
+  printf("  %-5s MC=%d KC=%d NC=%d tile=%dx%d\n", tuning_type_name<T>(),
+         t.blk.mc, t.blk.kc, t.blk.nc, t.mr, t.nr);
+}
+
+int main(int argc, char **argv) {
+  // Pull out our own flags before handing the rest to the benchmark library
+  bool autotune = false;
+  int tune_size = 1024;
+  const std::string size_flag = "--tune_size=";
+  int kept = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--autotune") == 0) {
+      autotune = true;
+    } else if (strncmp(argv[i], size_flag.c_str(), size_flag.size()) == 0) {
+      tune_size = atoi(argv[i] + size_flag.size());
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+  // Tune before anything loads the cache
+  if (autotune) {
+    retune<int>(tune_size);
+    retune<float>(tune_size);
+  }
+  printf("Tuning for %s (%s):\n", cpu_model_name().c_str(),
+         tuning_cache_path().c_str());
+  printTuning<int>();
+  printTuning<float>();
+  printf("\n");
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+}
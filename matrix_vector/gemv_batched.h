@@ -0,0 +1,265 @@
+// Batched matrix-vector multiplication (one matrix times a block of k
+// vectors). Each row of the matrix is loaded once and reused for every
+// vector in the block, so the matrix only streams from memory once.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include "gemv_kernels.h"
+
+// Vectors and results are stored one after another (k x dim, row-major):
+//   vector b is vs[b * dim ... b * dim + dim)
+//   result b is rs[b * dim ... b * dim + dim)
+
+// Scalar reference version
+inline void matrix_vector_batched_scalar(const float *m, const float *vs,
+                                         float *rs, int dim, int k) {
+  for (int b = 0; b < k; b++) {
+    matrix_vector_scalar(m, vs + static_cast<size_t>(b) * dim,
+                         rs + static_cast<size_t>(b) * dim, dim);
+  }
+}
+
+// The vectorized versions work on column panels: the slices of all k
+// vectors that fall in a panel should stay in cache while every row of the
+// matrix streams past them (k * panel_columns floats). Within a panel, a
+// block of rows is run against a small group of vectors at a time, so each
+// load of a vector slice feeds every row of the block and each load of a
+// row feeds every vector of the group. Partial dot products from each
+// panel are added into the results.
+
+// Rows run against each group of vectors at once
+constexpr int batched_block_rows = 4;
+
+// Columns per panel for k vectors (a multiple of width, at least one vector
+// width and at most the whole row)
+inline int batched_panel_columns(int dim, int k, int width) {
+  // Bytes of vector slices per panel. They only have to stay in L2: the
+  // row blocks already cut how often they're loaded, and smaller
+  // (L1-sized) panels cost more in per-panel reductions than they save.
+  const size_t budget = 256 << 10;
+  size_t columns = budget / (sizeof(float) * std::max(k, 1));
+  columns = std::max<size_t>(columns / width * width, width);
+  return static_cast<int>(std::min<size_t>(columns, dim));
+}
+
+// Dot products of NR rows against NV vectors over columns [j0, j1) (one
+// accumulator per pair). Results are written to rs (first panel) or added
+// to it (later panels). Only the last panel of a row has a partial vector.
+template <int NR, int NV>
+__attribute__((target("avx2,fma"))) inline void dot_block_avx2(
+    const float *rows, const float *vs, float *rs, int dim, int j0, int j1,
+    bool first) {
+  __m256 acc[NR][NV];
+#pragma GCC unroll 8
+  for (int r = 0; r < NR; r++) {
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) acc[r][b] = _mm256_setzero_ps();
+  }
+
+  int j = j0;
+  for (; j + 8 <= j1; j += 8) {
+    __m256 v[NV];
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      v[b] = _mm256_loadu_ps(vs + static_cast<size_t>(b) * dim + j);
+    }
+#pragma GCC unroll 8
+    for (int r = 0; r < NR; r++) {
+      __m256 a = _mm256_loadu_ps(rows + static_cast<size_t>(r) * dim + j);
+#pragma GCC unroll 8
+      for (int b = 0; b < NV; b++) {
+        acc[r][b] = _mm256_fmadd_ps(a, v[b], acc[r][b]);
+      }
+    }
+  }
+
+  // Masked tail
+  if (j < j1) {
+    __m256i mask = tail_mask_avx2(j1 - j);
+    __m256 v[NV];
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      v[b] = _mm256_maskload_ps(vs + static_cast<size_t>(b) * dim + j, mask);
+    }
+#pragma GCC unroll 8
+    for (int r = 0; r < NR; r++) {
+      __m256 a =
+          _mm256_maskload_ps(rows + static_cast<size_t>(r) * dim + j, mask);
+#pragma GCC unroll 8
+      for (int b = 0; b < NV; b++) {
+        acc[r][b] = _mm256_fmadd_ps(a, v[b], acc[r][b]);
+      }
+    }
+  }
+
+  // One reduction per (row, vector) pair per panel
+#pragma GCC unroll 8
+  for (int r = 0; r < NR; r++) {
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      float &out = rs[static_cast<size_t>(b) * dim + r];
+      out = (first ? 0.0f : out) + hsum_avx2(acc[r][b]);
+    }
+  }
+}
+
+// Rows i0 .. i0 + NR - 1 against every vector over columns [j0, j1), in
+// groups of NV vectors (and then one at a time)
+template <int NR, int NV>
+__attribute__((target("avx2,fma"))) inline void row_block_avx2(
+    const float *m, const float *vs, float *rs, int dim, int k, int i0,
+    int j0, int j1) {
+  const float *rows = m + static_cast<size_t>(i0) * dim;
+  int b = 0;
+  for (; b + NV <= k; b += NV) {
+    dot_block_avx2<NR, NV>(rows, vs + static_cast<size_t>(b) * dim,
+                           rs + static_cast<size_t>(b) * dim + i0, dim, j0,
+                           j1, j0 == 0);
+  }
+  for (; b < k; b++) {
+    dot_block_avx2<NR, 1>(rows, vs + static_cast<size_t>(b) * dim,
+                          rs + static_cast<size_t>(b) * dim + i0, dim, j0, j1,
+                          j0 == 0);
+  }
+}
+
+// 4 rows x 2 vectors is 8 accumulators, plus the 2 vector slices and a row
+// (11 of the 16 ymm registers)
+__attribute__((target("avx2,fma"))) inline void matrix_vector_batched_avx2(
+    const float *m, const float *vs, float *rs, int dim, int k) {
+  const int panel = batched_panel_columns(dim, k, 8);
+  for (int j0 = 0; j0 < dim; j0 += panel) {
+    int j1 = std::min(j0 + panel, dim);
+    int i = 0;
+    for (; i + batched_block_rows <= dim; i += batched_block_rows) {
+      row_block_avx2<batched_block_rows, 2>(m, vs, rs, dim, k, i, j0, j1);
+    }
+    for (; i < dim; i++) row_block_avx2<1, 2>(m, vs, rs, dim, k, i, j0, j1);
+  }
+}
+
+// AVX-512 version of the same idea
+template <int NR, int NV>
+__attribute__((target("avx512f"))) inline void dot_block_avx512(
+    const float *rows, const float *vs, float *rs, int dim, int j0, int j1,
+    bool first) {
+  __m512 acc[NR][NV];
+#pragma GCC unroll 8
+  for (int r = 0; r < NR; r++) {
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) acc[r][b] = _mm512_setzero_ps();
+  }
+
+  int j = j0;
+  for (; j + 16 <= j1; j += 16) {
+    __m512 v[NV];
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      v[b] = _mm512_loadu_ps(vs + static_cast<size_t>(b) * dim + j);
+    }
+#pragma GCC unroll 8
+    for (int r = 0; r < NR; r++) {
+      __m512 a = _mm512_loadu_ps(rows + static_cast<size_t>(r) * dim + j);
+#pragma GCC unroll 8
+      for (int b = 0; b < NV; b++) {
+        acc[r][b] = _mm512_fmadd_ps(a, v[b], acc[r][b]);
+      }
+    }
+  }
+
+  // Masked tail
+  if (j < j1) {
+    __mmask16 mask = static_cast<__mmask16>((1u << (j1 - j)) - 1);
+    __m512 v[NV];
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      v[b] = _mm512_maskz_loadu_ps(mask, vs + static_cast<size_t>(b) * dim + j);
+    }
+#pragma GCC unroll 8
+    for (int r = 0; r < NR; r++) {
+      __m512 a =
+          _mm512_maskz_loadu_ps(mask, rows + static_cast<size_t>(r) * dim + j);
+#pragma GCC unroll 8
+      for (int b = 0; b < NV; b++) {
+        acc[r][b] = _mm512_fmadd_ps(a, v[b], acc[r][b]);
+      }
+    }
+  }
+
+#pragma GCC unroll 8
+  for (int r = 0; r < NR; r++) {
+#pragma GCC unroll 8
+    for (int b = 0; b < NV; b++) {
+      float &out = rs[static_cast<size_t>(b) * dim + r];
+      out = (first ? 0.0f : out) + _mm512_reduce_add_ps(acc[r][b]);
+    }
+  }
+}
+
+template <int NR, int NV>
+__attribute__((target("avx512f"))) inline void row_block_avx512(
+    const float *m, const float *vs, float *rs, int dim, int k, int i0,
+    int j0, int j1) {
+  const float *rows = m + static_cast<size_t>(i0) * dim;
+  int b = 0;
+  for (; b + NV <= k; b += NV) {
+    dot_block_avx512<NR, NV>(rows, vs + static_cast<size_t>(b) * dim,
+                             rs + static_cast<size_t>(b) * dim + i0, dim, j0,
+                             j1, j0 == 0);
+  }
+  for (; b < k; b++) {
+    dot_block_avx512<NR, 1>(rows, vs + static_cast<size_t>(b) * dim,
+                            rs + static_cast<size_t>(b) * dim + i0, dim, j0,
+                            j1, j0 == 0);
+  }
+}
+
+// 4 rows x 4 vectors is 16 accumulators (of 32 zmm registers)
+__attribute__((target("avx512f"))) inline void matrix_vector_batched_avx512(
+    const float *m, const float *vs, float *rs, int dim, int k) {
+  const int panel = batched_panel_columns(dim, k, 16);
+  for (int j0 = 0; j0 < dim; j0 += panel) {
+    int j1 = std::min(j0 + panel, dim);
+    int i = 0;
+    for (; i + batched_block_rows <= dim; i += batched_block_rows) {
+      row_block_avx512<batched_block_rows, 4>(m, vs, rs, dim, k, i, j0, j1);
+    }
+    for (; i < dim; i++) row_block_avx512<1, 4>(m, vs, rs, dim, k, i, j0, j1);
+  }
+}
+
+// Bytes the dispatched kernel moves through the cache hierarchy: the
+// matrix once, every vector slice once per block of rows, and the results
+// read and written once per panel (the scalar loop reads the matrix and
+// the vector once per vector and row)
+inline double matrix_vector_batched_traffic(int dim, int k) {
+  double n = dim;
+  if (best_gemv_isa() < GemvIsa::avx2) {
+    return sizeof(float) * k * (2.0 * n * n + n);
+  }
+  int width = best_gemv_isa() == GemvIsa::avx512 ? 16 : 8;
+  int panel = batched_panel_columns(dim, k, width);
+  int panels = (dim + panel - 1) / panel;
+  int row_blocks = (dim + batched_block_rows - 1) / batched_block_rows;
+  return sizeof(float) *
+         (n * n + double(row_blocks) * k * n + 2.0 * panels * k * n);
+}
+
+// Runtime dispatch (SSE machines just get the scalar loop)
+inline void matrix_vector_batched(const float *m, const float *vs, float *rs,
+                                  int dim, int k) {
+  static const GemvIsa isa = best_gemv_isa();
+  switch (isa) {
+    case GemvIsa::avx512:
+      matrix_vector_batched_avx512(m, vs, rs, dim, k);
+      break;
+    case GemvIsa::avx2:
+      matrix_vector_batched_avx2(m, vs, rs, dim, k);
+      break;
+    default:
+      matrix_vector_batched_scalar(m, vs, rs, dim, k);
+      break;
+  }
+}
@@ -0,0 +1,256 @@
+// A family of matrix-vector multiplication kernels that keep several
+// independent accumulators and only do a horizontal reduction once per
+// row. The best kernel for the CPU we're running on is picked at runtime,
+// and every kernel handles any dim (not just multiples of the SIMD width).
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <cstddef>
+
+// Signature shared by every kernel in the family (r = m * v)
+using gemv_kernel = void (*)(const float *m, const float *v, float *r,
+                             int dim);
+
+// Plain scalar version (our reference)
+inline void matrix_vector_scalar(const float *m, const float *v, float *r,
+                                 int dim) {
+  for (int i = 0; i < dim; i++) {
+    const float *row = m + static_cast<size_t>(i) * dim;
+    float tmp = 0;
+    for (int j = 0; j < dim; j++) {
+      tmp += row[j] * v[j];
+    }
+    r[i] = tmp;
+  }
+}
+
+// SSE version (no FMA, so a separate multiply and add)
+__attribute__((target("sse2"))) inline float dot_sse(const float *a,
+                                                      const float *b,
+                                                      int dim) {
+  // Four independent accumulators to hide the latency of the adds
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  __m128 acc2 = _mm_setzero_ps();
+  __m128 acc3 = _mm_setzero_ps();
+  int j = 0;
+  for (; j + 16 <= dim; j += 16) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + j),
+                                       _mm_loadu_ps(b + j)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + j + 4),
+                                       _mm_loadu_ps(b + j + 4)));
+    acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(a + j + 8),
+                                       _mm_loadu_ps(b + j + 8)));
+    acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(a + j + 12),
+                                       _mm_loadu_ps(b + j + 12)));
+  }
+  for (; j + 4 <= dim; j += 4) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + j),
+                                       _mm_loadu_ps(b + j)));
+  }
+
+  // Reduce the accumulators (once per row)
+  __m128 acc = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+  float res = _mm_cvtss_f32(acc);
+
+  // Scalar tail
+  for (; j < dim; j++) res += a[j] * b[j];
+  return res;
+}
+
+__attribute__((target("sse2"))) inline void matrix_vector_sse(const float *m,
+                                                              const float *v,
+                                                              float *r,
+                                                              int dim) {
+  for (int i = 0; i < dim; i++) {
+    r[i] = dot_sse(m + static_cast<size_t>(i) * dim, v, dim);
+  }
+}
+
+// Sum of the eight lanes of an AVX register
+__attribute__((target("avx2,fma"))) inline float hsum_avx2(__m256 acc) {
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc),
+                           _mm256_extractf128_ps(acc, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_movehdup_ps(half));
+  return _mm_cvtss_f32(half);
+}
+
+// Mask for the last (dim - j) < 8 elements of a row
+__attribute__((target("avx2,fma"))) inline __m256i tail_mask_avx2(int n) {
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  return _mm256_cmpgt_epi32(_mm256_set1_epi32(n), lane);
+}
+
+// AVX2 + FMA version
+__attribute__((target("avx2,fma"))) inline float dot_avx2(const float *a,
+                                                          const float *b,
+                                                          int dim) {
+  // Four independent FMA chains (FMA latency is ~4 cycles with 2 ports)
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps();
+  __m256 acc3 = _mm256_setzero_ps();
+  int j = 0;
+  for (; j + 32 <= dim; j += 32) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j),
+                           acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 8),
+                           _mm256_loadu_ps(b + j + 8), acc1);
+    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 16),
+                           _mm256_loadu_ps(b + j + 16), acc2);
+    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 24),
+                           _mm256_loadu_ps(b + j + 24), acc3);
+  }
+  for (; j + 8 <= dim; j += 8) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j),
+                           acc0);
+  }
+
+  // Masked tail (maskload never touches the lanes that are masked off)
+  if (j < dim) {
+    __m256i mask = tail_mask_avx2(dim - j);
+    acc1 = _mm256_fmadd_ps(_mm256_maskload_ps(a + j, mask),
+                           _mm256_maskload_ps(b + j, mask), acc1);
+  }
+
+  // Reduce the accumulators (once per row)
+  return hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1),
+                                 _mm256_add_ps(acc2, acc3)));
+}
+
+__attribute__((target("avx2,fma"))) inline void matrix_vector_avx2(
+    const float *m, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    r[i] = dot_avx2(m + static_cast<size_t>(i) * dim, v, dim);
+  }
+}
+
+// AVX-512 version
+__attribute__((target("avx512f"))) inline float dot_avx512(const float *a,
+                                                           const float *b,
+                                                           int dim) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  __m512 acc2 = _mm512_setzero_ps();
+  __m512 acc3 = _mm512_setzero_ps();
+  int j = 0;
+  for (; j + 64 <= dim; j += 64) {
+    acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j),
+                           acc0);
+    acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j + 16),
+                           _mm512_loadu_ps(b + j + 16), acc1);
+    acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j + 32),
+                           _mm512_loadu_ps(b + j + 32), acc2);
+    acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j + 48),
+                           _mm512_loadu_ps(b + j + 48), acc3);
+  }
+  for (; j + 16 <= dim; j += 16) {
+    acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j),
+                           acc0);
+  }
+
+  // Masked tail
+  if (j < dim) {
+    __mmask16 mask = static_cast<__mmask16>((1u << (dim - j)) - 1);
+    acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + j),
+                           _mm512_maskz_loadu_ps(mask, b + j), acc1);
+  }
+
+  // Reduce the accumulators (once per row)
+  __m512 acc = _mm512_add_ps(_mm512_add_ps(acc0, acc1),
+                             _mm512_add_ps(acc2, acc3));
+  return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f"))) inline void matrix_vector_avx512(
+    const float *m, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    r[i] = dot_avx512(m + static_cast<size_t>(i) * dim, v, dim);
+  }
+}
+
+// Instruction sets we have kernels for
+enum class GemvIsa { scalar, sse, avx2, avx512 };
+
+inline const char *gemv_isa_name(GemvIsa isa) {
+  switch (isa) {
+    case GemvIsa::sse:
+      return "sse";
+    case GemvIsa::avx2:
+      return "avx2";
+    case GemvIsa::avx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+// Is this instruction set supported by the CPU we're running on?
+inline bool gemv_isa_supported(GemvIsa isa) {
+  __builtin_cpu_init();
+  switch (isa) {
+    case GemvIsa::sse:
+      return __builtin_cpu_supports("sse2");
+    case GemvIsa::avx2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case GemvIsa::avx512:
+      return __builtin_cpu_supports("avx512f");
+    default:
+      return true;
+  }
+}
+
+// The best instruction set supported by this CPU
+inline GemvIsa best_gemv_isa() {
+  if (gemv_isa_supported(GemvIsa::avx512)) return GemvIsa::avx512;
+  if (gemv_isa_supported(GemvIsa::avx2)) return GemvIsa::avx2;
+  if (gemv_isa_supported(GemvIsa::sse)) return GemvIsa::sse;
+  return GemvIsa::scalar;
+}
+
+inline gemv_kernel gemv_kernel_for(GemvIsa isa) {
+  switch (isa) {
+    case GemvIsa::sse:
+      return matrix_vector_sse;
+    case GemvIsa::avx2:
+      return matrix_vector_avx2;
+    case GemvIsa::avx512:
+      return matrix_vector_avx512;
+    default:
+      return matrix_vector_scalar;
+  }
+}
+
+// Runtime dispatch (the CPU check only happens on the first call)
+inline void matrix_vector(const float *m, const float *v, float *r, int dim) {
+  static const gemv_kernel kernel = gemv_kernel_for(best_gemv_isa());
+  kernel(m, v, r, dim);
+}
+
+// Single dot product with the best kernel (for callers that walk the rows
+// themselves)
+inline float gemv_dot(const float *a, const float *b, int dim) {
+  using dot_kernel = float (*)(const float *, const float *, int);
+  static const dot_kernel kernel = []() -> dot_kernel {
+    switch (best_gemv_isa()) {
+      case GemvIsa::avx512:
+        return dot_avx512;
+      case GemvIsa::avx2:
+        return dot_avx2;
+      case GemvIsa::sse:
+        return dot_sse;
+      default:
+        return [](const float *x, const float *y, int n) {
+          float tmp = 0;
+          for (int j = 0; j < n; j++) tmp += x[j] * y[j];
+          return tmp;
+        };
+    }
+  }();
+  return kernel(a, b, dim);
+}
@@ -0,0 +1,198 @@
+// Out-of-core matrix-vector multiplication on a matrix stored in a file
+// (raw row-major floats). The file is memory-mapped and processed in
+// panels of rows. While one panel is being multiplied, the next one is
+// already being read in, either by a readahead hint to the kernel or by a
+// helper thread that faults its pages in.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "gemv_kernels.h"
+
+// Write a dim x dim matrix of random floats to a file (returns false on
+// failure)
+inline bool write_matrix_file(const char *path, int dim) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  std::vector<float> row(dim);
+  bool ok = true;
+  for (int i = 0; i < dim && ok; i++) {
+    for (auto &x : row) x = rand() % 100;
+    ok = fwrite(row.data(), sizeof(float), dim, f) == size_t(dim);
+  }
+  return fclose(f) == 0 && ok;
+}
+
+// Drop the file's (clean) pages from the page cache, so the next pass
+// really goes to the disk
+inline void evict_file(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// Read-only mapping of a dim x dim matrix file
+class MappedMatrix {
+ public:
+  MappedMatrix() = default;
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+  ~MappedMatrix() { unmap(); }
+
+  // Returns false if the file can't be opened/mapped or has the wrong size
+  bool map(const char *path, int dim) {
+    unmap();
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    bytes = sizeof(float) * static_cast<size_t>(dim) * dim;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < bytes) {
+      unmap();
+      return false;
+    }
+    void *p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      unmap();
+      return false;
+    }
+    data = static_cast<const float *>(p);
+    this->dim = dim;
+
+    // We only ever walk the file front to back
+    madvise(p, bytes, MADV_SEQUENTIAL);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return true;
+  }
+
+  void unmap() {
+    if (data) munmap(const_cast<float *>(data), bytes);
+    if (fd >= 0) close(fd);
+    data = nullptr;
+    fd = -1;
+  }
+
+  const float *row(size_t i) const { return data + i * dim; }
+
+  // Address range of rows [begin, end) in whole pages. The start always
+  // rounds down (madvise wants a page-aligned address). The end rounds up
+  // to cover every page the rows touch, or down to leave out the page we
+  // share with row end (which belongs to the next panel, if there is one).
+  void page_range(int begin, int end, bool round_up, char **start,
+                  size_t *len) const {
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t lo = reinterpret_cast<uintptr_t>(row(begin)) & ~(page - 1);
+    uintptr_t hi = reinterpret_cast<uintptr_t>(row(end));
+    if (round_up || end == dim) hi += page - 1;
+    hi &= ~(page - 1);
+    *start = reinterpret_cast<char *>(lo);
+    *len = hi > lo ? hi - lo : 0;
+  }
+
+  // Ask the kernel to start reading rows [begin, end) in the background
+  void will_need(int begin, int end) const {
+    char *start;
+    size_t len;
+    page_range(begin, end, true, &start, &len);
+    madvise(start, len, MADV_WILLNEED);
+  }
+
+  // Tell the kernel we're done with rows [begin, end) so it can drop them
+  // from the page cache before anything more useful
+  void done_with(int begin, int end) const {
+    // Pages that are still mapped stay in the page cache, so unmap them from
+    // our page tables first (touching them again just faults them back in)
+    char *start;
+    size_t len;
+    page_range(begin, end, false, &start, &len);
+    if (len) madvise(start, len, MADV_DONTNEED);
+
+    size_t offset = sizeof(float) * static_cast<size_t>(begin) * dim;
+    len = sizeof(float) * static_cast<size_t>(end - begin) * dim;
+    posix_fadvise(fd, offset, len, POSIX_FADV_DONTNEED);
+  }
+
+  // Touch one byte per page of rows [begin, end) to fault them in
+  void prefault(int begin, int end) const {
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    const char *p = reinterpret_cast<const char *>(row(begin));
+    const char *last = reinterpret_cast<const char *>(row(end));
+    char sink = 0;
+    for (; p < last; p += page) {
+      sink ^= *reinterpret_cast<const volatile char *>(p);
+    }
+    (void)sink;
+  }
+
+  const float *data = nullptr;
+  size_t bytes = 0;
+  int dim = 0;
+  int fd = -1;
+};
+
+// How the next panel gets read while we work on the current one
+enum class StreamMode {
+  advise,   // madvise(MADV_WILLNEED) on the next panel
+  thread,   // a helper thread faults the next panels in
+};
+
+// r = m * v, streaming the mapped matrix in panels of panel_rows rows.
+// With drop_behind, panels are evicted from the page cache once we've used
+// them (so a huge matrix doesn't push everything else out of memory).
+inline void matrix_vector_streaming(const MappedMatrix &m, const float *v,
+                                    float *r, int panel_rows,
+                                    StreamMode mode = StreamMode::advise,
+                                    bool drop_behind = false) {
+  const int dim = m.dim;
+  const int panels = (dim + panel_rows - 1) / panel_rows;
+  auto panel_begin = [&](int p) { return std::min(dim, p * panel_rows); };
+
+  // The helper thread stays (at most) two panels ahead of us
+  const int depth = 2;
+  std::atomic<int> consumed{0};
+  std::atomic<bool> stop{false};
+  std::thread helper;
+  if (mode == StreamMode::thread) {
+    helper = std::thread([&] {
+      for (int p = 0; p < panels && !stop; p++) {
+        while (p >= consumed.load(std::memory_order_acquire) + depth) {
+          if (stop) return;
+          std::this_thread::yield();
+        }
+        m.prefault(panel_begin(p), panel_begin(p + 1));
+      }
+    });
+  } else {
+    m.will_need(panel_begin(0), panel_begin(1));
+  }
+
+  for (int p = 0; p < panels; p++) {
+    // Start on the next panel before we compute this one
+    if (mode == StreamMode::advise && p + 1 < panels) {
+      m.will_need(panel_begin(p + 1), panel_begin(p + 2));
+    }
+
+    for (int i = panel_begin(p); i < panel_begin(p + 1); i++) {
+      r[i] = gemv_dot(m.row(i), v, dim);
+    }
+    consumed.store(p + 1, std::memory_order_release);
+
+    if (drop_behind) m.done_with(panel_begin(p), panel_begin(p + 1));
+  }
+
+  stop = true;
+  if (helper.joinable()) helper.join();
+}
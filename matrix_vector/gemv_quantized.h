@@ -0,0 +1,322 @@
+// Matrix-vector multiplication with the matrix stored in a reduced
+// precision format. The matrix is widened to fp32 in registers and all
+// accumulation happens in fp32, so we only save on the bytes we stream.
+//   fp16 - IEEE half precision (converted with F16C)
+//   bf16 - bfloat16 (the top 16 bits of an fp32)
+//   int8 - 8-bit integers with one fp32 scale per row
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "gemv_kernels.h"
+
+// Can this CPU run the AVX2 + FMA kernels? (bf16 and int8 widen with
+// shifts and converts, so that's all they need)
+inline bool quantized_simd_supported() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+// The fp16 kernel also needs F16C for the conversions
+inline bool fp16_simd_supported() {
+  __builtin_cpu_init();
+  return quantized_simd_supported() && __builtin_cpu_supports("f16c");
+}
+
+// fp16 ------------------------------------------------------------------
+
+// Software conversions (used by the packing and the scalar fallbacks)
+inline uint16_t float_to_half(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000;
+  int32_t exp = static_cast<int32_t>((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+
+  // NaN/Inf, overflow, and values too small for a subnormal
+  if (((x >> 23) & 0xff) == 0xff) {
+    return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 : 0));
+  }
+  if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+  if (exp <= -11) return static_cast<uint16_t>(sign);
+
+  // Subnormal halves
+  if (exp <= 0) {
+    mant |= 0x800000;
+    uint32_t shift = 14 - exp;
+    uint32_t half = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t mid = 1u << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  // Normal halves (round to nearest even, which may carry into the exponent)
+  uint32_t half = (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;
+  return static_cast<uint16_t>(sign | half);
+}
+
+inline float half_to_float(uint16_t h) {
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  uint32_t x;
+  if (exp == 0x1f) {
+    x = sign | 0x7f800000 | (mant << 13);
+  } else if (exp != 0) {
+    x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  } else if (mant == 0) {
+    x = sign;
+  } else {
+    // Normalize the subnormal
+    exp = 127 - 15 + 1;
+    while (!(mant & 0x400)) {
+      mant <<= 1;
+      exp--;
+    }
+    x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+  }
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// Convert a whole matrix to fp16
+inline void pack_fp16(const float *m, uint16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) out[i] = float_to_half(m[i]);
+}
+
+inline void matrix_vector_fp16_scalar(const uint16_t *m, const float *v,
+                                      float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const uint16_t *row = m + static_cast<size_t>(i) * dim;
+    float tmp = 0;
+    for (int j = 0; j < dim; j++) tmp += half_to_float(row[j]) * v[j];
+    r[i] = tmp;
+  }
+}
+
+__attribute__((target("avx2,fma,f16c"))) inline void matrix_vector_fp16_avx2(
+    const uint16_t *m, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const uint16_t *row = m + static_cast<size_t>(i) * dim;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 32 <= dim; j += 32) {
+      // Each 16-byte load is 8 halves, which widen to 8 floats
+      acc0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128(
+                                 reinterpret_cast<const __m128i *>(row + j))),
+                             _mm256_loadu_ps(v + j), acc0);
+      acc1 = _mm256_fmadd_ps(
+          _mm256_cvtph_ps(
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + j + 8))),
+          _mm256_loadu_ps(v + j + 8), acc1);
+      acc2 = _mm256_fmadd_ps(
+          _mm256_cvtph_ps(_mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(row + j + 16))),
+          _mm256_loadu_ps(v + j + 16), acc2);
+      acc3 = _mm256_fmadd_ps(
+          _mm256_cvtph_ps(_mm_loadu_si128(
+              reinterpret_cast<const __m128i *>(row + j + 24))),
+          _mm256_loadu_ps(v + j + 24), acc3);
+    }
+    for (; j + 8 <= dim; j += 8) {
+      acc0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128(
+                                 reinterpret_cast<const __m128i *>(row + j))),
+                             _mm256_loadu_ps(v + j), acc0);
+    }
+    float tmp = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1),
+                                        _mm256_add_ps(acc2, acc3)));
+
+    // Scalar tail
+    for (; j < dim; j++) tmp += _cvtsh_ss(row[j]) * v[j];
+    r[i] = tmp;
+  }
+}
+
+inline void matrix_vector_fp16(const uint16_t *m, const float *v, float *r,
+                               int dim) {
+  static const bool simd = fp16_simd_supported();
+  if (simd) {
+    matrix_vector_fp16_avx2(m, v, r, dim);
+  } else {
+    matrix_vector_fp16_scalar(m, v, r, dim);
+  }
+}
+
+// bf16 ------------------------------------------------------------------
+
+// Round to nearest even on the 16 bits we throw away
+inline uint16_t float_to_bf16(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  if ((x & 0x7fffffff) > 0x7f800000) {
+    return static_cast<uint16_t>((x >> 16) | 0x40);
+  }
+  x += 0x7fff + ((x >> 16) & 1);
+  return static_cast<uint16_t>(x >> 16);
+}
+
+inline float bf16_to_float(uint16_t b) {
+  uint32_t x = static_cast<uint32_t>(b) << 16;
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// Convert a whole matrix to bf16
+inline void pack_bf16(const float *m, uint16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) out[i] = float_to_bf16(m[i]);
+}
+
+inline void matrix_vector_bf16_scalar(const uint16_t *m, const float *v,
+                                      float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const uint16_t *row = m + static_cast<size_t>(i) * dim;
+    float tmp = 0;
+    for (int j = 0; j < dim; j++) tmp += bf16_to_float(row[j]) * v[j];
+    r[i] = tmp;
+  }
+}
+
+// Widening bf16 is just a zero-extend and a shift
+__attribute__((target("avx2,fma"))) inline __m256 load_bf16_avx2(
+    const uint16_t *p) {
+  __m256i x = _mm256_cvtepu16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+}
+
+__attribute__((target("avx2,fma"))) inline void matrix_vector_bf16_avx2(
+    const uint16_t *m, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const uint16_t *row = m + static_cast<size_t>(i) * dim;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 32 <= dim; j += 32) {
+      acc0 = _mm256_fmadd_ps(load_bf16_avx2(row + j), _mm256_loadu_ps(v + j),
+                             acc0);
+      acc1 = _mm256_fmadd_ps(load_bf16_avx2(row + j + 8),
+                             _mm256_loadu_ps(v + j + 8), acc1);
+      acc2 = _mm256_fmadd_ps(load_bf16_avx2(row + j + 16),
+                             _mm256_loadu_ps(v + j + 16), acc2);
+      acc3 = _mm256_fmadd_ps(load_bf16_avx2(row + j + 24),
+                             _mm256_loadu_ps(v + j + 24), acc3);
+    }
+    for (; j + 8 <= dim; j += 8) {
+      acc0 = _mm256_fmadd_ps(load_bf16_avx2(row + j), _mm256_loadu_ps(v + j),
+                             acc0);
+    }
+    float tmp = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1),
+                                        _mm256_add_ps(acc2, acc3)));
+
+    // Scalar tail
+    for (; j < dim; j++) tmp += bf16_to_float(row[j]) * v[j];
+    r[i] = tmp;
+  }
+}
+
+inline void matrix_vector_bf16(const uint16_t *m, const float *v, float *r,
+                               int dim) {
+  static const bool simd = quantized_simd_supported();
+  if (simd) {
+    matrix_vector_bf16_avx2(m, v, r, dim);
+  } else {
+    matrix_vector_bf16_scalar(m, v, r, dim);
+  }
+}
+
+// int8 ------------------------------------------------------------------
+
+// Symmetric quantization with one scale per row (q = round(x / scale))
+inline void pack_int8(const float *m, int8_t *out, float *scales, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const float *row = m + static_cast<size_t>(i) * dim;
+    int8_t *q = out + static_cast<size_t>(i) * dim;
+
+    // Map the largest magnitude in the row to 127
+    float max_abs = 0;
+    for (int j = 0; j < dim; j++) {
+      max_abs = std::fmax(max_abs, std::fabs(row[j]));
+    }
+    float scale = max_abs > 0 ? max_abs / 127.0f : 1.0f;
+    scales[i] = scale;
+
+    for (int j = 0; j < dim; j++) {
+      q[j] = static_cast<int8_t>(std::lrint(row[j] / scale));
+    }
+  }
+}
+
+inline void matrix_vector_int8_scalar(const int8_t *m, const float *scales,
+                                      const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const int8_t *row = m + static_cast<size_t>(i) * dim;
+    float tmp = 0;
+    for (int j = 0; j < dim; j++) tmp += static_cast<float>(row[j]) * v[j];
+    r[i] = tmp * scales[i];
+  }
+}
+
+// Widen 8 int8s to 8 floats
+__attribute__((target("avx2,fma"))) inline __m256 load_int8_avx2(
+    const int8_t *p) {
+  __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+  return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(x));
+}
+
+__attribute__((target("avx2,fma"))) inline void matrix_vector_int8_avx2(
+    const int8_t *m, const float *scales, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    const int8_t *row = m + static_cast<size_t>(i) * dim;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 32 <= dim; j += 32) {
+      acc0 = _mm256_fmadd_ps(load_int8_avx2(row + j), _mm256_loadu_ps(v + j),
+                             acc0);
+      acc1 = _mm256_fmadd_ps(load_int8_avx2(row + j + 8),
+                             _mm256_loadu_ps(v + j + 8), acc1);
+      acc2 = _mm256_fmadd_ps(load_int8_avx2(row + j + 16),
+                             _mm256_loadu_ps(v + j + 16), acc2);
+      acc3 = _mm256_fmadd_ps(load_int8_avx2(row + j + 24),
+                             _mm256_loadu_ps(v + j + 24), acc3);
+    }
+    for (; j + 8 <= dim; j += 8) {
+      acc0 = _mm256_fmadd_ps(load_int8_avx2(row + j), _mm256_loadu_ps(v + j),
+                             acc0);
+    }
+    float tmp = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1),
+                                        _mm256_add_ps(acc2, acc3)));
+
+    // Scalar tail
+    for (; j < dim; j++) tmp += static_cast<float>(row[j]) * v[j];
+
+    // Apply the row scale once at the end
+    r[i] = tmp * scales[i];
+  }
+}
+
+inline void matrix_vector_int8(const int8_t *m, const float *scales,
+                               const float *v, float *r, int dim) {
+  static const bool simd = quantized_simd_supported();
+  if (simd) {
+    matrix_vector_int8_avx2(m, scales, v, r, dim);
+  } else {
+    matrix_vector_int8_scalar(m, scales, v, r, dim);
+  }
+}
@@ -0,0 +1,205 @@
+// Transposed matrix-vector multiplication (y = A^T x) on the same
+// row-major matrices matrix_vector() uses, without building the transpose.
+// Instead of walking columns with a stride of dim, we stream panels of
+// four rows and accumulate x[i] * A[i][:] into y with SIMD, so y is only
+// loaded and stored once per panel.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include "../common/thread_pool.h"
+#include "gemv_kernels.h"
+
+// Column walk (the column-major access pattern from prefetching.cpp)
+inline void matrix_vector_transposed_naive(const float *m, const float *x,
+                                           float *y, int dim) {
+  for (int j = 0; j < dim; j++) {
+    float tmp = 0;
+    for (int i = 0; i < dim; i++) {
+      tmp += m[static_cast<size_t>(i) * dim + j] * x[i];
+    }
+    y[j] = tmp;
+  }
+}
+
+// All kernels below accumulate rows [begin, end) into y (y += A[rows]^T x)
+
+inline void mvt_rows_scalar(const float *m, const float *x, float *y, int dim,
+                            int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    const float *row = m + static_cast<size_t>(i) * dim;
+    for (int j = 0; j < dim; j++) y[j] += x[i] * row[j];
+  }
+}
+
+__attribute__((target("avx2,fma"))) inline void mvt_rows_avx2(
+    const float *m, const float *x, float *y, int dim, int begin, int end) {
+  int i = begin;
+
+  // Panels of four rows
+  for (; i + 4 <= end; i += 4) {
+    const float *r0 = m + static_cast<size_t>(i) * dim;
+    const float *r1 = r0 + dim;
+    const float *r2 = r1 + dim;
+    const float *r3 = r2 + dim;
+    __m256 x0 = _mm256_set1_ps(x[i]);
+    __m256 x1 = _mm256_set1_ps(x[i + 1]);
+    __m256 x2 = _mm256_set1_ps(x[i + 2]);
+    __m256 x3 = _mm256_set1_ps(x[i + 3]);
+    int j = 0;
+    for (; j + 8 <= dim; j += 8) {
+      __m256 acc = _mm256_loadu_ps(y + j);
+      acc = _mm256_fmadd_ps(x0, _mm256_loadu_ps(r0 + j), acc);
+      acc = _mm256_fmadd_ps(x1, _mm256_loadu_ps(r1 + j), acc);
+      acc = _mm256_fmadd_ps(x2, _mm256_loadu_ps(r2 + j), acc);
+      acc = _mm256_fmadd_ps(x3, _mm256_loadu_ps(r3 + j), acc);
+      _mm256_storeu_ps(y + j, acc);
+    }
+
+    // Masked tail
+    if (j < dim) {
+      __m256i mask = tail_mask_avx2(dim - j);
+      __m256 acc = _mm256_maskload_ps(y + j, mask);
+      acc = _mm256_fmadd_ps(x0, _mm256_maskload_ps(r0 + j, mask), acc);
+      acc = _mm256_fmadd_ps(x1, _mm256_maskload_ps(r1 + j, mask), acc);
+      acc = _mm256_fmadd_ps(x2, _mm256_maskload_ps(r2 + j, mask), acc);
+      acc = _mm256_fmadd_ps(x3, _mm256_maskload_ps(r3 + j, mask), acc);
+      _mm256_maskstore_ps(y + j, mask, acc);
+    }
+  }
+
+  // Leftover rows one at a time
+  for (; i < end; i++) {
+    const float *row = m + static_cast<size_t>(i) * dim;
+    __m256 xi = _mm256_set1_ps(x[i]);
+    int j = 0;
+    for (; j + 8 <= dim; j += 8) {
+      _mm256_storeu_ps(y + j, _mm256_fmadd_ps(xi, _mm256_loadu_ps(row + j),
+                                              _mm256_loadu_ps(y + j)));
+    }
+    if (j < dim) {
+      __m256i mask = tail_mask_avx2(dim - j);
+      _mm256_maskstore_ps(
+          y + j, mask,
+          _mm256_fmadd_ps(xi, _mm256_maskload_ps(row + j, mask),
+                          _mm256_maskload_ps(y + j, mask)));
+    }
+  }
+}
+
+__attribute__((target("avx512f"))) inline void mvt_rows_avx512(
+    const float *m, const float *x, float *y, int dim, int begin, int end) {
+  int i = begin;
+  for (; i + 4 <= end; i += 4) {
+    const float *r0 = m + static_cast<size_t>(i) * dim;
+    const float *r1 = r0 + dim;
+    const float *r2 = r1 + dim;
+    const float *r3 = r2 + dim;
+    __m512 x0 = _mm512_set1_ps(x[i]);
+    __m512 x1 = _mm512_set1_ps(x[i + 1]);
+    __m512 x2 = _mm512_set1_ps(x[i + 2]);
+    __m512 x3 = _mm512_set1_ps(x[i + 3]);
+    int j = 0;
+    for (; j + 16 <= dim; j += 16) {
+      __m512 acc = _mm512_loadu_ps(y + j);
+      acc = _mm512_fmadd_ps(x0, _mm512_loadu_ps(r0 + j), acc);
+      acc = _mm512_fmadd_ps(x1, _mm512_loadu_ps(r1 + j), acc);
+      acc = _mm512_fmadd_ps(x2, _mm512_loadu_ps(r2 + j), acc);
+      acc = _mm512_fmadd_ps(x3, _mm512_loadu_ps(r3 + j), acc);
+      _mm512_storeu_ps(y + j, acc);
+    }
+    if (j < dim) {
+      __mmask16 mask = static_cast<__mmask16>((1u << (dim - j)) - 1);
+      __m512 acc = _mm512_maskz_loadu_ps(mask, y + j);
+      acc = _mm512_fmadd_ps(x0, _mm512_maskz_loadu_ps(mask, r0 + j), acc);
+      acc = _mm512_fmadd_ps(x1, _mm512_maskz_loadu_ps(mask, r1 + j), acc);
+      acc = _mm512_fmadd_ps(x2, _mm512_maskz_loadu_ps(mask, r2 + j), acc);
+      acc = _mm512_fmadd_ps(x3, _mm512_maskz_loadu_ps(mask, r3 + j), acc);
+      _mm512_mask_storeu_ps(y + j, mask, acc);
+    }
+  }
+  for (; i < end; i++) {
+    const float *row = m + static_cast<size_t>(i) * dim;
+    __m512 xi = _mm512_set1_ps(x[i]);
+    int j = 0;
+    for (; j + 16 <= dim; j += 16) {
+      _mm512_storeu_ps(y + j, _mm512_fmadd_ps(xi, _mm512_loadu_ps(row + j),
+                                              _mm512_loadu_ps(y + j)));
+    }
+    if (j < dim) {
+      __mmask16 mask = static_cast<__mmask16>((1u << (dim - j)) - 1);
+      _mm512_mask_storeu_ps(
+          y + j, mask,
+          _mm512_fmadd_ps(xi, _mm512_maskz_loadu_ps(mask, row + j),
+                          _mm512_maskz_loadu_ps(mask, y + j)));
+    }
+  }
+}
+
+// Pick the row kernel for this CPU
+using mvt_rows_kernel = void (*)(const float *, const float *, float *, int,
+                                 int, int);
+inline mvt_rows_kernel best_mvt_rows_kernel() {
+  static const mvt_rows_kernel kernel = [] {
+    switch (best_gemv_isa()) {
+      case GemvIsa::avx512:
+        return mvt_rows_avx512;
+      case GemvIsa::avx2:
+        return mvt_rows_avx2;
+      default:
+        return mvt_rows_scalar;
+    }
+  }();
+  return kernel;
+}
+
+// y = A^T x
+inline void matrix_vector_transposed(const float *m, const float *x, float *y,
+                                     int dim) {
+  std::memset(y, 0, sizeof(float) * dim);
+  best_mvt_rows_kernel()(m, x, y, dim, 0, dim);
+}
+
+// Threaded version --------------------------------------------------------
+
+// Each thread accumulates its block of rows into a private copy of y. The
+// copies are padded to whole cache lines, so as long as scratch starts on
+// a cache line (64-byte aligned) threads never share a line.
+inline int mvt_partial_stride(int dim) { return (dim + 15) / 16 * 16; }
+
+// Floats of scratch space the threaded version needs
+inline size_t mvt_scratch_size(int threads, int dim) {
+  return static_cast<size_t>(threads) * mvt_partial_stride(dim);
+}
+
+// y = A^T x, with rows split across the pool and a parallel reduction
+// (scratch must hold mvt_scratch_size(pool.size(), dim) floats, and be
+// 64-byte aligned)
+inline void matrix_vector_transposed(ThreadPool &pool, float *scratch,
+                                     const float *m, const float *x, float *y,
+                                     int dim) {
+  const int threads = pool.size();
+  const int stride = mvt_partial_stride(dim);
+  mvt_rows_kernel kernel = best_mvt_rows_kernel();
+
+  // Phase 1: private partial sums for each block of rows
+  pool.run([&](int id) {
+    float *partial = scratch + static_cast<size_t>(id) * stride;
+    std::memset(partial, 0, sizeof(float) * dim);
+    auto rows = split_range(dim, threads, id);
+    kernel(m, x, partial, dim, rows.first, rows.second);
+  });
+
+  // Phase 2: each thread reduces a slice of the columns across all partials
+  pool.run([&](int id) {
+    auto cols = split_range(dim, threads, id);
+    for (int j = cols.first; j < cols.second; j++) y[j] = scratch[j];
+    for (int t = 1; t < threads; t++) {
+      const float *partial = scratch + static_cast<size_t>(t) * stride;
+      for (int j = cols.first; j < cols.second; j++) y[j] += partial[j];
+    }
+  });
+}
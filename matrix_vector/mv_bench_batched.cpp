@@ -0,0 +1,97 @@
+// This program benchmarks batched matrix-vector multiplication (one matrix
+// times k vectors) against calling the single-vector kernel k times
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "gemv_batched.h"
+
+using namespace std;
+
+// Shared setup for both benchmarks
+struct BatchedData {
+  BatchedData(int dim, int k)
+      : matrix(new float[size_t(dim) * dim]),
+        vecs(new float[size_t(k) * dim]),
+        res(new float[size_t(k) * dim]()) {
+    for (size_t i = 0; i < size_t(dim) * dim; i++) matrix[i] = rand() % 100;
+    for (size_t i = 0; i < size_t(k) * dim; i++) vecs[i] = rand() % 100;
+  }
+  ~BatchedData() {
+    delete[] matrix;
+    delete[] vecs;
+    delete[] res;
+  }
+  float *matrix;
+  float *vecs;
+  float *res;
+};
+
+// Report flops and how many bytes the kernel moved (through the caches,
+// not just from memory) for each one
+static void setCounters(benchmark::State &s, int dim, int k, double bytes) {
+  double flops = 2.0 * dim * dim * k;
+  s.SetItemsProcessed(int64_t(dim) * dim * k * s.iterations());
+  s.SetBytesProcessed(int64_t(bytes) * s.iterations());
+  s.counters["FLOP/s"] =
+      benchmark::Counter(flops * s.iterations(), benchmark::Counter::kIsRate);
+  s.counters["bytes/flop"] = bytes / flops;
+}
+
+// k vectors in a single pass over the matrix
+static void mvBenchBatched(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  int k = s.range(1);
+  BatchedData d(dim, k);
+
+  // Check the kernel against the scalar loop before timing it (sums past
+  // 2^24 round differently depending on their order)
+  vector<float> ref(size_t(k) * dim);
+  matrix_vector_batched_scalar(d.matrix, d.vecs, ref.data(), dim, k);
+  matrix_vector_batched(d.matrix, d.vecs, d.res, dim, k);
+  auto close = [](float x, float y) { return fabs(x - y) <= 1e-5f * fabs(y); };
+  if (!equal(ref.begin(), ref.end(), d.res, close)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    matrix_vector_batched(d.matrix, d.vecs, d.res, dim, k);
+    benchmark::ClobberMemory();
+  }
+
+  // The matrix is read once, but the vectors are read again for every
+  // block of rows
+  setCounters(s, dim, k, matrix_vector_batched_traffic(dim, k));
+}
+BENCHMARK(mvBenchBatched)
+    ->ArgsProduct({{10, 12}, {1, 2, 4, 8, 16, 32, 64}})
+    ->Unit(benchmark::kMicrosecond);
+
+// k separate calls to the single-vector kernel
+static void mvBenchLoop(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  int k = s.range(1);
+  BatchedData d(dim, k);
+
+  while (s.KeepRunning()) {
+    for (int b = 0; b < k; b++) {
+      matrix_vector(d.matrix, d.vecs + size_t(b) * dim, d.res + size_t(b) * dim,
+                    dim);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  // The whole matrix is streamed once per vector, and the vector is read
+  // again for every row
+  setCounters(s, dim, k, sizeof(float) * double(k) * dim * (2.0 * dim + 1));
+}
+BENCHMARK(mvBenchLoop)
+    ->ArgsProduct({{10, 12}, {1, 2, 4, 8, 16, 32, 64}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
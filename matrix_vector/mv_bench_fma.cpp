@@ -0,0 +1,104 @@
+// This program benchmarks matrix-vector multiplication kernels that use
+// multiple FMA accumulators, with the instruction set picked at runtime.
+// Unlike mv_bench_avx.cpp, dim does not have to be a multiple of eight.
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdlib>
+#include "gemv_kernels.h"
+
+using namespace std;
+
+// Benchmark one kernel (a single member of the family, or the
+// matrix_vector() dispatch)
+static void mvBench(benchmark::State &s, gemv_kernel kernel) {
+  // Get the size from the input (not always a power of two!)
+  int dim = s.range(0);
+
+  // Allocate and initialize
+  float *matrix = new float[dim * dim];
+  float *vec = new float[dim];
+  float *res = new float[dim];
+
+  // Initialize the allocated space
+  for (int i = 0; i < dim; i++) {
+    vec[i] = rand() % 100;
+    res[i] = 0;
+    for (int j = 0; j < dim; j++) {
+      matrix[i * dim + j] = rand() % 100;
+    }
+  }
+
+  // Check the kernel (tails included) against the scalar one before timing
+  // it. The inputs are small integers, so any order of sums is exact.
+  float *ref = new float[dim];
+  matrix_vector_scalar(matrix, vec, ref, dim);
+  kernel(matrix, vec, res, dim);
+  bool correct = equal(res, res + dim, ref);
+  delete[] ref;
+  if (!correct) {
+    s.SkipWithError("Incorrect result");
+    delete[] matrix;
+    delete[] vec;
+    delete[] res;
+    return;
+  }
+
+  // Run matrix vector product in a loop
+  while (s.KeepRunning()) {
+    kernel(matrix, vec, res, dim);
+    benchmark::ClobberMemory();
+  }
+
+  // Free our memory
+  delete[] matrix;
+  delete[] vec;
+  delete[] res;
+
+  // Set the items processed
+  s.SetItemsProcessed(dim * dim * s.iterations());
+
+  // Set bytes processed
+  s.SetBytesProcessed(sizeof(float) * dim * (dim + 2) * s.iterations());
+}
+
+// Benchmark a single kernel from the family
+static void mvBenchKernel(benchmark::State &s, GemvIsa isa) {
+  // Make sure this CPU can run the kernel
+  if (!gemv_isa_supported(isa)) {
+    s.SkipWithError("instruction set not supported on this CPU");
+    return;
+  }
+  mvBench(s, gemv_kernel_for(isa));
+}
+
+// Benchmark the public entry point (whatever dispatch picks)
+static void mvBenchDispatch(benchmark::State &s) { mvBench(s, matrix_vector); }
+
+// Sizes to test (including ones that aren't a multiple of any SIMD width)
+static void Sizes(benchmark::internal::Benchmark *b) {
+  for (int dim : {255, 256, 1000, 1023, 1024, 1500}) {
+    b->Arg(dim);
+  }
+}
+
+// Register a benchmark for each kernel, and one for whatever dispatch picks
+BENCHMARK_CAPTURE(mvBenchKernel, scalar, GemvIsa::scalar)
+    ->Apply(Sizes)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchKernel, sse, GemvIsa::sse)
+    ->Apply(Sizes)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchKernel, avx2, GemvIsa::avx2)
+    ->Apply(Sizes)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchKernel, avx512, GemvIsa::avx512)
+    ->Apply(Sizes)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(mvBenchDispatch)
+    ->Apply(Sizes)
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
@@ -0,0 +1,149 @@
+// This program benchmarks out-of-core matrix-vector multiplication on a
+// memory-mapped matrix file, and compares it against how fast we can just
+// read the same file sequentially. The page cache is dropped before every
+// iteration so each pass really comes from the disk.
+//
+// Matrix files are written to $MV_MATRIX_DIR (default /tmp) and removed
+// when the program exits.
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+#include "gemv_mmap.h"
+
+using namespace std;
+
+// Files we've created (so we only write each one once, and clean up)
+static set<string> &matrixFiles() {
+  static set<string> files;
+  return files;
+}
+
+static void removeMatrixFiles() {
+  for (const auto &f : matrixFiles()) remove(f.c_str());
+}
+
+// Path to a dim x dim matrix file (written the first time it's asked for)
+static string matrixFile(int dim) {
+  const char *dir = getenv("MV_MATRIX_DIR");
+  string path = string(dir ? dir : "/tmp") + "/mv_matrix_" +
+                to_string(dim) + ".bin";
+  if (!matrixFiles().count(path)) {
+    if (!write_matrix_file(path.c_str(), dim)) return "";
+    if (matrixFiles().empty()) atexit(removeMatrixFiles);
+    matrixFiles().insert(path);
+  }
+  return path;
+}
+
+// Read the whole file with read() into a large buffer (returns bytes/s)
+static double sequentialRead(const string &path, vector<char> &buffer) {
+  auto start = chrono::steady_clock::now();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return 0;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  size_t total = 0;
+  ssize_t n;
+  while ((n = read(fd, buffer.data(), buffer.size())) > 0) total += n;
+  close(fd);
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return total / elapsed.count();
+}
+
+// Raw sequential read speed of the file (our upper bound)
+static void readBench(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  string path = matrixFile(dim);
+  if (path.empty()) {
+    s.SkipWithError("could not write the matrix file");
+    return;
+  }
+  vector<char> buffer(4 << 20);
+
+  while (s.KeepRunning()) {
+    s.PauseTiming();
+    evict_file(path.c_str());
+    s.ResumeTiming();
+    sequentialRead(path, buffer);
+  }
+  s.SetBytesProcessed(sizeof(float) * int64_t(dim) * dim * s.iterations());
+}
+
+// Streaming matrix-vector multiplication from the mapped file
+static void mvBenchMmap(benchmark::State &s, StreamMode mode) {
+  int dim = 1 << s.range(0);
+  int panel_mib = s.range(1);
+  string path = matrixFile(dim);
+  if (path.empty()) {
+    s.SkipWithError("could not write the matrix file");
+    return;
+  }
+
+  // Rows per panel
+  int panel_rows = max<size_t>(1, (size_t(panel_mib) << 20) /
+                                      (sizeof(float) * dim));
+
+  vector<float> vec(dim);
+  vector<float> res(dim);
+  for (auto &x : vec) x = rand() % 100;
+
+  // Cold sequential read speed of the same file (for comparison)
+  vector<char> buffer(4 << 20);
+  evict_file(path.c_str());
+  double read_speed = sequentialRead(path, buffer);
+
+  MappedMatrix m;
+  double seconds = 0;
+  while (s.KeepRunning()) {
+    // Start every pass with nothing cached or mapped
+    s.PauseTiming();
+    m.unmap();
+    evict_file(path.c_str());
+    s.ResumeTiming();
+
+    auto start = chrono::steady_clock::now();
+    if (!m.map(path.c_str(), dim)) {
+      s.SkipWithError("could not map the matrix file");
+      break;
+    }
+    matrix_vector_streaming(m, vec.data(), res.data(), panel_rows, mode,
+                            true);
+    benchmark::ClobberMemory();
+    seconds += chrono::duration<double>(chrono::steady_clock::now() - start)
+                   .count();
+  }
+
+  // Set the items processed
+  s.SetItemsProcessed(int64_t(dim) * dim * s.iterations());
+
+  // Set bytes processed (just the matrix, the vectors stay in memory)
+  int64_t bytes = sizeof(float) * int64_t(dim) * dim;
+  s.SetBytesProcessed(bytes * s.iterations());
+
+  // How close we got to just reading the file
+  s.counters["read_B/s"] = read_speed;
+  if (seconds > 0) {
+    s.counters["of_read"] = bytes * s.iterations() / seconds / read_speed;
+  }
+}
+
+// Register the benchmarks (dim as a power of two, and panel size in MiB)
+BENCHMARK(readBench)
+    ->DenseRange(12, 14)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mvBenchMmap, advise, StreamMode::advise)
+    ->ArgsProduct({{12, 13, 14}, {1, 8, 32}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(mvBenchMmap, thread, StreamMode::thread)
+    ->ArgsProduct({{12, 13, 14}, {1, 8, 32}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
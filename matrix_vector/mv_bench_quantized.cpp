@@ -0,0 +1,114 @@
+// This program benchmarks matrix-vector multiplication with the matrix
+// stored as fp32, fp16, bf16, or int8 (with per-row scales), and reports
+// the error of each format against the fp32 result
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "gemv_quantized.h"
+
+using namespace std;
+
+// Storage formats for the matrix
+enum class Format { fp32, fp16, bf16, int8 };
+
+static void mvBenchQuantized(benchmark::State &s, Format format) {
+  // Get the size from the input
+  int dim = 1 << s.range(0);
+  size_t elements = size_t(dim) * dim;
+
+  // Use real-valued data (small integers are exact in fp16 and bf16, which
+  // would hide the rounding error we want to measure)
+  vector<float> matrix(elements);
+  vector<float> vec(dim);
+  vector<float> res(dim);
+  vector<float> ref(dim);
+  for (auto &x : matrix) x = 2.0f * rand() / RAND_MAX - 1.0f;
+  for (auto &x : vec) x = 2.0f * rand() / RAND_MAX - 1.0f;
+
+  // Our fp32 reference result
+  matrix_vector(matrix.data(), vec.data(), ref.data(), dim);
+
+  // Convert the matrix to the format we're testing
+  vector<uint16_t> halves;
+  vector<int8_t> bytes;
+  vector<float> scales;
+  size_t bytes_per_pass = 0;
+  switch (format) {
+    case Format::fp32:
+      bytes_per_pass = sizeof(float) * elements;
+      break;
+    case Format::fp16:
+      halves.resize(elements);
+      pack_fp16(matrix.data(), halves.data(), elements);
+      bytes_per_pass = sizeof(uint16_t) * elements;
+      break;
+    case Format::bf16:
+      halves.resize(elements);
+      pack_bf16(matrix.data(), halves.data(), elements);
+      bytes_per_pass = sizeof(uint16_t) * elements;
+      break;
+    case Format::int8:
+      bytes.resize(elements);
+      scales.resize(dim);
+      pack_int8(matrix.data(), bytes.data(), scales.data(), dim);
+      bytes_per_pass = elements + sizeof(float) * dim;
+      break;
+  }
+
+  // Run matrix vector product in a loop
+  while (s.KeepRunning()) {
+    switch (format) {
+      case Format::fp32:
+        matrix_vector(matrix.data(), vec.data(), res.data(), dim);
+        break;
+      case Format::fp16:
+        matrix_vector_fp16(halves.data(), vec.data(), res.data(), dim);
+        break;
+      case Format::bf16:
+        matrix_vector_bf16(halves.data(), vec.data(), res.data(), dim);
+        break;
+      case Format::int8:
+        matrix_vector_int8(bytes.data(), scales.data(), vec.data(),
+                           res.data(), dim);
+        break;
+    }
+    benchmark::ClobberMemory();
+  }
+
+  // Compare the last result against the fp32 reference
+  double max_err = 0;
+  double sum_err = 0;
+  for (int i = 0; i < dim; i++) {
+    double err = fabs(double(res[i]) - double(ref[i]));
+    max_err = fmax(max_err, err);
+    sum_err += err;
+  }
+  s.counters["max_err"] = max_err;
+  s.counters["mean_err"] = sum_err / dim;
+
+  // Set the items processed
+  s.SetItemsProcessed(int64_t(elements) * s.iterations());
+
+  // Set bytes processed (the matrix plus the fp32 input and output vectors)
+  s.SetBytesProcessed(
+      int64_t(bytes_per_pass + 2 * sizeof(float) * dim) * s.iterations());
+}
+// Register the benchmarks
+BENCHMARK_CAPTURE(mvBenchQuantized, fp32, Format::fp32)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchQuantized, fp16, Format::fp16)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchQuantized, bf16, Format::bf16)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvBenchQuantized, int8, Format::int8)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
@@ -0,0 +1,117 @@
+// This program implements a multi-threaded benchmark for matrix-vector
+// multiplication. Rows are split across a persistent pool of pinned
+// threads, and each thread first-touches the rows it will later stream
+// so the pages land on its own NUMA node.
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <thread>
+#include "../common/thread_pool.h"
+
+using namespace std;
+
+// Matrix-vector multiplication for the rows [begin, end)
+void matrix_vector_rows(const float *m, const float *v, float *r, int dim,
+                        int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    // Accumulate in a local so we don't reload r[i] every iteration
+    float tmp = 0;
+    for (int j = 0; j < dim; j++) {
+      tmp += v[j] * m[static_cast<size_t>(i) * dim + j];
+    }
+    r[i] = tmp;
+  }
+}
+
+// Parallel matrix-vector multiplication (each thread gets a block of rows)
+void matrix_vector(ThreadPool &pool, const float *m, const float *v, float *r,
+                   int dim) {
+  pool.run([&](int id) {
+    auto rows = split_range(dim, pool.size(), id);
+    matrix_vector_rows(m, v, r, dim, rows.first, rows.second);
+  });
+}
+
+// Helper allocator function for posix_memalign
+float *allocate(size_t bytes) {
+  // Allocate memory alligned to 64-bytes
+  void *memory;
+  if (posix_memalign(&memory, 64, bytes)) abort();
+  return static_cast<float *>(memory);
+}
+
+static void mvBenchThreaded(benchmark::State &s) {
+  // Get the size and number of threads from the input
+  int dim = 1 << s.range(0);
+  int num_threads = s.range(1);
+
+  // Create our pool of pinned threads
+  ThreadPool pool(num_threads);
+
+  // Allocate (but don't touch) the matrix
+  float *matrix = allocate(static_cast<size_t>(dim) * dim * sizeof(float));
+  float *vec = allocate(dim * sizeof(float));
+  float *res = allocate(dim * sizeof(float));
+
+  // The vector is shared by everyone, so just initialize it here
+  for (int i = 0; i < dim; i++) {
+    vec[i] = rand() % 100;
+  }
+
+  // First-touch the matrix and result with the same row split used in the
+  // multiplication so each thread's rows are placed on its NUMA node
+  pool.run([&](int id) {
+    auto rows = split_range(dim, pool.size(), id);
+    unsigned seed = id;
+    for (int i = rows.first; i < rows.second; i++) {
+      res[i] = 0;
+      for (int j = 0; j < dim; j++) {
+        matrix[static_cast<size_t>(i) * dim + j] = rand_r(&seed) % 100;
+      }
+    }
+  });
+
+  // Run matrix vector product in a loop
+  while (s.KeepRunning()) {
+    matrix_vector(pool, matrix, vec, res, dim);
+    benchmark::ClobberMemory();
+  }
+
+  // Free our memory
+  free(matrix);
+  free(vec);
+  free(res);
+
+  // Set the items processed
+  s.SetItemsProcessed(int64_t(dim) * dim * s.iterations());
+
+  // Set bytes processed
+  int64_t bytes = int64_t(sizeof(float)) * dim * (dim + 2) * s.iterations();
+  s.SetBytesProcessed(bytes);
+
+  // Bandwidth each thread achieves (where this drops off, we're saturated)
+  s.counters["BW/thread"] = benchmark::Counter(
+      static_cast<double>(bytes) / num_threads, benchmark::Counter::kIsRate,
+      benchmark::Counter::OneK::kIs1024);
+}
+
+// Sweep the number of threads in powers of two up to the number of cores
+static void ThreadArgs(benchmark::internal::Benchmark *b) {
+  int max_threads = std::thread::hardware_concurrency();
+  if (max_threads < 1) max_threads = 1;
+  for (int dim = 10; dim <= 13; dim++) {
+    for (int t = 1; t < max_threads; t *= 2) {
+      b->Args({dim, t});
+    }
+    b->Args({dim, max_threads});
+  }
+}
+// Register the benchmark (the worker threads do the work, so use real time)
+BENCHMARK(mvBenchThreaded)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
@@ -0,0 +1,152 @@
+// This program benchmarks transposed matrix-vector multiplication
+// (y = A^T x) on a row-major matrix against the regular y = A x
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "gemv_transposed.h"
+
+using namespace std;
+
+// Shared setup for all the benchmarks
+struct MvData {
+  explicit MvData(int dim) : matrix(size_t(dim) * dim), x(dim), y(dim) {
+    for (auto &e : matrix) e = rand() % 100;
+    for (auto &e : x) e = rand() % 100;
+  }
+  vector<float> matrix;
+  vector<float> x;
+  vector<float> y;
+};
+
+// Every benchmark streams the same matrix once
+static void setCounters(benchmark::State &s, int dim) {
+  s.SetItemsProcessed(int64_t(dim) * dim * s.iterations());
+  s.SetBytesProcessed(sizeof(float) * int64_t(dim) * (dim + 2) *
+                      s.iterations());
+}
+
+// Does d.y match the naive A^T x? (The sums are done in a different
+// order, so allow some rounding)
+static bool matchesNaive(const MvData &d, int dim) {
+  vector<float> ref(dim);
+  matrix_vector_transposed_naive(d.matrix.data(), d.x.data(), ref.data(), dim);
+  for (int j = 0; j < dim; j++) {
+    if (fabs(d.y[j] - ref[j]) > 1e-5f * fabs(ref[j])) return false;
+  }
+  return true;
+}
+
+// Regular y = A x (what we want A^T x to cost)
+static void mvBench(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  MvData d(dim);
+  while (s.KeepRunning()) {
+    matrix_vector(d.matrix.data(), d.x.data(), d.y.data(), dim);
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, dim);
+}
+BENCHMARK(mvBench)->DenseRange(10, 12)->Unit(benchmark::kMicrosecond);
+
+// Walking down the columns
+static void mvtNaive(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  MvData d(dim);
+  while (s.KeepRunning()) {
+    matrix_vector_transposed_naive(d.matrix.data(), d.x.data(), d.y.data(),
+                                   dim);
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, dim);
+}
+BENCHMARK(mvtNaive)->DenseRange(10, 12)->Unit(benchmark::kMicrosecond);
+
+// Row-major, one row at a time, scalar code
+static void mvtRows(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  MvData d(dim);
+
+  // Check the result before timing anything
+  mvt_rows_scalar(d.matrix.data(), d.x.data(), d.y.data(), dim, 0, dim);
+  if (!matchesNaive(d, dim)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    fill(d.y.begin(), d.y.end(), 0.0f);
+    mvt_rows_scalar(d.matrix.data(), d.x.data(), d.y.data(), dim, 0, dim);
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, dim);
+}
+BENCHMARK(mvtRows)->DenseRange(10, 12)->Unit(benchmark::kMicrosecond);
+
+// Four-row panels with SIMD
+static void mvtPanels(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  MvData d(dim);
+
+  // Check the result before timing anything
+  matrix_vector_transposed(d.matrix.data(), d.x.data(), d.y.data(), dim);
+  if (!matchesNaive(d, dim)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    matrix_vector_transposed(d.matrix.data(), d.x.data(), d.y.data(), dim);
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, dim);
+}
+BENCHMARK(mvtPanels)->DenseRange(10, 12)->Unit(benchmark::kMicrosecond);
+
+// Four-row panels split across threads, with a parallel reduction
+static void mvtThreaded(benchmark::State &s) {
+  int dim = 1 << s.range(0);
+  int threads = s.range(1);
+  MvData d(dim);
+  ThreadPool pool(threads);
+
+  // Scratch has to start on a cache line
+  void *memory;
+  size_t bytes = sizeof(float) * mvt_scratch_size(threads, dim);
+  if (posix_memalign(&memory, 64, bytes)) abort();
+  float *scratch = static_cast<float *>(memory);
+
+  // Check the result (the split and the reduction) before timing anything
+  matrix_vector_transposed(pool, scratch, d.matrix.data(), d.x.data(),
+                           d.y.data(), dim);
+  if (!matchesNaive(d, dim)) {
+    s.SkipWithError("Incorrect result");
+    free(scratch);
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    matrix_vector_transposed(pool, scratch, d.matrix.data(), d.x.data(),
+                             d.y.data(), dim);
+    benchmark::ClobberMemory();
+  }
+  free(scratch);
+  setCounters(s, dim);
+}
+static void ThreadArgs(benchmark::internal::Benchmark *b) {
+  int max_threads = max(1u, thread::hardware_concurrency());
+  for (int dim = 10; dim <= 12; dim++) {
+    for (int t = 1; t < max_threads; t *= 2) b->Args({dim, t});
+    b->Args({dim, max_threads});
+  }
+}
+BENCHMARK(mvtThreaded)
+    ->Apply(ThreadArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
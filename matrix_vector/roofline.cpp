@@ -0,0 +1,329 @@
+// This program places the matrix-vector kernels on a roofline. It first
+// measures the machine's peak FMA throughput and streaming read bandwidth,
+// then runs each kernel, takes its arithmetic intensity from the same
+// items/bytes accounting the other mv benchmarks use, and reports what
+// fraction of the roofline it reaches at each dim (as a table and a CSV).
+//
+// Usage: ./roofline [--roofline_csv=<file>] [benchmark flags]
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "gemv_kernels.h"
+
+using namespace std;
+
+// Range of dims (as powers of two) we run every kernel on
+const int min_dim = 8;
+const int max_dim = 12;
+
+// Kernels ------------------------------------------------------------------
+
+// The original loop from mv_bench.cpp
+void matrix_vector_naive(const float *m, const float *v, float *r, int dim) {
+  for (int i = 0; i < dim; i++) {
+    for (int j = 0; j < dim; j++) {
+      r[i] += v[j] * m[i * dim + j];
+    }
+  }
+}
+
+// The _mm256_dp_ps version from mv_bench_avx.cpp
+__attribute__((target("avx"))) void matrix_vector_dp(const float *m,
+                                                    const float *v, float *r,
+                                                    int dim) {
+  for (int i = 0; i < dim; i++) {
+    float res = 0;
+    for (int j = 0; j < dim; j += 8) {
+      float tmp[8];
+      __m256 rv = _mm256_dp_ps(_mm256_loadu_ps(m + i * dim + j),
+                               _mm256_loadu_ps(v + j), 0xf1);
+      std::memcpy(tmp, &rv, sizeof(float) * 8);
+      res += tmp[0] + tmp[4];
+    }
+    r[i] = res;
+  }
+}
+
+// Machine peaks ------------------------------------------------------------
+
+using Clock = chrono::steady_clock;
+
+// Peak FMA throughput with enough independent chains to cover the latency
+__attribute__((target("avx512f"))) double fma_chains_avx512(long iters) {
+  const __m512 x = _mm512_set1_ps(0.999999f);
+  const __m512 y = _mm512_set1_ps(1e-7f);
+  __m512 acc[16];
+  for (int c = 0; c < 16; c++) acc[c] = _mm512_set1_ps(c);
+  for (long i = 0; i < iters; i++) {
+#pragma GCC unroll 16
+    for (int c = 0; c < 16; c++) acc[c] = _mm512_fmadd_ps(acc[c], x, y);
+  }
+  __m512 sum = acc[0];
+  for (int c = 1; c < 16; c++) sum = _mm512_add_ps(sum, acc[c]);
+  return _mm512_reduce_add_ps(sum);
+}
+
+__attribute__((target("avx2,fma"))) double fma_chains_avx2(long iters) {
+  const __m256 x = _mm256_set1_ps(0.999999f);
+  const __m256 y = _mm256_set1_ps(1e-7f);
+  __m256 acc[12];
+  for (int c = 0; c < 12; c++) acc[c] = _mm256_set1_ps(c);
+  for (long i = 0; i < iters; i++) {
+#pragma GCC unroll 12
+    for (int c = 0; c < 12; c++) acc[c] = _mm256_fmadd_ps(acc[c], x, y);
+  }
+  __m256 sum = acc[0];
+  for (int c = 1; c < 12; c++) sum = _mm256_add_ps(sum, acc[c]);
+  return hsum_avx2(sum);
+}
+
+// Returns peak flop/s (an FMA counts as two flops)
+double measurePeakFlops() {
+  GemvIsa isa = best_gemv_isa();
+  const long iters = 1 << 24;
+  double best = 0;
+  for (int rep = 0; rep < 3; rep++) {
+    double flops;
+    volatile double sink;
+    auto start = Clock::now();
+    if (isa == GemvIsa::avx512) {
+      sink = fma_chains_avx512(iters);
+      flops = 2.0 * 16 * 16 * iters;
+    } else if (isa == GemvIsa::avx2) {
+      sink = fma_chains_avx2(iters);
+      flops = 2.0 * 8 * 12 * iters;
+    } else {
+      // No FMA, so fall back to what the SSE kernel can issue
+      float acc[16] = {};
+      for (long i = 0; i < iters; i++) {
+        for (int c = 0; c < 16; c++) acc[c] = acc[c] * 0.999999f + 1e-7f;
+      }
+      sink = acc[0] + acc[15];
+      flops = 2.0 * 16 * iters;
+    }
+    (void)sink;
+    chrono::duration<double> elapsed = Clock::now() - start;
+    best = max(best, flops / elapsed.count());
+  }
+  return best;
+}
+
+// Sum a buffer as fast as we can (four independent accumulators)
+__attribute__((target("avx2"))) float read_sum_avx2(const float *p,
+                                                    size_t n) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps();
+  __m256 acc3 = _mm256_setzero_ps();
+  for (size_t i = 0; i + 32 <= n; i += 32) {
+    acc0 = _mm256_add_ps(acc0, _mm256_load_ps(p + i));
+    acc1 = _mm256_add_ps(acc1, _mm256_load_ps(p + i + 8));
+    acc2 = _mm256_add_ps(acc2, _mm256_load_ps(p + i + 16));
+    acc3 = _mm256_add_ps(acc3, _mm256_load_ps(p + i + 24));
+  }
+  return hsum_avx2(
+      _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+}
+
+float read_sum_scalar(const float *p, size_t n) {
+  float acc[8] = {};
+  for (size_t i = 0; i + 8 <= n; i += 8) {
+    for (int j = 0; j < 8; j++) acc[j] += p[i + j];
+  }
+  return acc[0] + acc[7];
+}
+
+// Peak streaming read bandwidth (bytes/s) for a buffer of the given size
+double measureReadBandwidth(size_t bytes) {
+  size_t n = bytes / sizeof(float);
+  void *memory;
+  if (posix_memalign(&memory, 64, n * sizeof(float))) abort();
+  float *buffer = static_cast<float *>(memory);
+  for (size_t i = 0; i < n; i++) buffer[i] = i % 100;
+
+  // Repeat small buffers so each timing covers at least ~256 MB
+  bool simd = gemv_isa_supported(GemvIsa::avx2);
+  size_t passes = max<size_t>(1, (size_t(1) << 28) / bytes);
+  double best = 0;
+  for (int rep = 0; rep < 5; rep++) {
+    volatile float sink;
+    auto start = Clock::now();
+    for (size_t p = 0; p < passes; p++) {
+      sink = simd ? read_sum_avx2(buffer, n) : read_sum_scalar(buffer, n);
+    }
+    (void)sink;
+    chrono::duration<double> elapsed = Clock::now() - start;
+    best = max(best, double(bytes) * passes / elapsed.count());
+  }
+  free(buffer);
+  return best;
+}
+
+// Peaks for this machine (bandwidth ceilings are per dim)
+double peak_flops;
+map<int, double> peak_bw;
+
+// Benchmarks ---------------------------------------------------------------
+
+static void mvRoofline(benchmark::State &s, gemv_kernel kernel) {
+  int dim = 1 << s.range(0);
+
+  void *memory;
+  if (posix_memalign(&memory, 64, size_t(dim) * dim * sizeof(float))) abort();
+  float *matrix = static_cast<float *>(memory);
+  float *vec = new float[dim];
+  float *res = new float[dim];
+  for (int i = 0; i < dim; i++) {
+    vec[i] = rand() % 100;
+    res[i] = 0;
+    for (int j = 0; j < dim; j++) {
+      matrix[i * dim + j] = rand() % 100;
+    }
+  }
+
+  while (s.KeepRunning()) {
+    kernel(matrix, vec, res, dim);
+    benchmark::ClobberMemory();
+  }
+
+  free(matrix);
+  delete[] vec;
+  delete[] res;
+
+  // Same accounting as mvBench
+  s.SetItemsProcessed(dim * dim * s.iterations());
+  s.SetBytesProcessed(sizeof(float) * dim * (dim + 2) * s.iterations());
+}
+BENCHMARK_CAPTURE(mvRoofline, naive, matrix_vector_naive)
+    ->DenseRange(min_dim, max_dim)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvRoofline, dp_ps, matrix_vector_dp)
+    ->DenseRange(min_dim, max_dim)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(mvRoofline, fma, matrix_vector)
+    ->DenseRange(min_dim, max_dim)
+    ->Unit(benchmark::kMicrosecond);
+
+// Reporting ----------------------------------------------------------------
+
+struct RooflineRow {
+  string kernel;
+  int dim;
+  double intensity;   // flop/byte
+  double achieved;    // flop/s
+  double attainable;  // flop/s (the roofline at this intensity)
+  bool memory_bound;
+};
+
+// Prints the usual console output, and saves what we need for the roofline
+class RooflineReporter : public benchmark::ConsoleReporter {
+ public:
+  void ReportRuns(const vector<Run> &runs) override {
+    ConsoleReporter::ReportRuns(runs);
+    for (const auto &run : runs) {
+      if (run.error_occurred || run.run_type != Run::RT_Iteration) continue;
+      auto items = run.counters.find("items_per_second");
+      auto bytes = run.counters.find("bytes_per_second");
+      if (items == run.counters.end() || bytes == run.counters.end()) {
+        continue;
+      }
+
+      // Name is mvRoofline/<kernel>/<log2 dim>
+      string name = run.benchmark_name();
+      size_t first = name.find('/');
+      size_t last = name.rfind('/');
+      int log_dim = stoi(name.substr(last + 1));
+
+      // Two flops (multiply and add) per item
+      RooflineRow row;
+      row.kernel = name.substr(first + 1, last - first - 1);
+      row.dim = 1 << log_dim;
+      row.achieved = 2.0 * items->second.value;
+      row.intensity = 2.0 * items->second.value / bytes->second.value;
+      double memory_roof = row.intensity * peak_bw[log_dim];
+      row.attainable = min(peak_flops, memory_roof);
+      row.memory_bound = memory_roof < peak_flops;
+      rows.push_back(row);
+    }
+  }
+
+  vector<RooflineRow> rows;
+};
+
+int main(int argc, char **argv) {
+  // Pull out our own flag before handing the rest to the benchmark library
+  string csv_path = "roofline.csv";
+  const string flag = "--roofline_csv=";
+  int kept = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], flag.c_str(), flag.size()) == 0) {
+      csv_path = argv[i] + flag.size();
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+  // Measure the roof
+  printf("Measuring peak FMA throughput (%s)...\n",
+         gemv_isa_name(best_gemv_isa()));
+  peak_flops = measurePeakFlops();
+  printf("  %.2f GFLOP/s\n", peak_flops / 1e9);
+  printf("Measuring streaming read bandwidth...\n");
+  for (int d = min_dim; d <= max_dim; d++) {
+    size_t bytes = sizeof(float) * (size_t(1) << d) * (size_t(1) << d);
+    peak_bw[d] = measureReadBandwidth(bytes);
+    printf("  %8zu KiB: %.2f GB/s\n", bytes >> 10, peak_bw[d] / 1e9);
+  }
+  printf("\n");
+
+  // Run the kernels
+  RooflineReporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+
+  // Table
+  printf("\n%-10s %6s %10s %12s %12s %8s %s\n", "kernel", "dim", "flop/byte",
+         "GFLOP/s", "roof GFLOP/s", "% roof", "bound");
+  for (const auto &row : reporter.rows) {
+    printf("%-10s %6d %10.3f %12.2f %12.2f %7.1f%% %s\n", row.kernel.c_str(),
+           row.dim, row.intensity, row.achieved / 1e9, row.attainable / 1e9,
+           100.0 * row.achieved / row.attainable,
+           row.memory_bound ? "memory" : "compute");
+  }
+
+  // CSV (for plotting)
+  FILE *csv = fopen(csv_path.c_str(), "w");
+  if (!csv) {
+    perror(csv_path.c_str());
+    return 1;
+  }
+  fprintf(csv,
+          "kernel,dim,intensity_flop_per_byte,achieved_gflops,"
+          "peak_bandwidth_gbs,peak_gflops,roof_gflops,fraction_of_roof,"
+          "bound\n");
+  for (const auto &row : reporter.rows) {
+    int log_dim = __builtin_ctz(row.dim);
+    fprintf(csv, "%s,%d,%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%s\n",
+            row.kernel.c_str(), row.dim, row.intensity, row.achieved / 1e9,
+            peak_bw[log_dim] / 1e9, peak_flops / 1e9, row.attainable / 1e9,
+            row.achieved / row.attainable,
+            row.memory_bound ? "memory" : "compute");
+  }
+  fclose(csv);
+  printf("\nWrote %s\n", csv_path.c_str());
+
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,292 @@
+// Sparse matrix-vector multiplication in two formats:
+//   CSR       - compressed sparse row (values and column indices per row)
+//   SELL-C-s  - sliced ELLPACK: rows are sorted by length inside windows of
+//               sigma rows, then packed in chunks of C rows stored
+//               column-by-column so one SIMD register holds C rows
+// Both can be built from our usual dense row-major layout, and both have
+// gather-based AVX2 kernels plus an optional row-partitioned threaded mode.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <immintrin.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "../common/thread_pool.h"
+#include "gemv_kernels.h"
+
+// CSR ---------------------------------------------------------------------
+
+struct CsrMatrix {
+  int rows = 0;
+  int cols = 0;
+  std::vector<int> row_ptr;  // rows + 1 offsets into col_idx/values
+  std::vector<int> col_idx;
+  std::vector<float> values;
+};
+
+// Build a CSR matrix from a dense row-major one (dropping exact zeros)
+inline CsrMatrix dense_to_csr(const float *m, int rows, int cols) {
+  CsrMatrix csr;
+  csr.rows = rows;
+  csr.cols = cols;
+  csr.row_ptr.reserve(rows + 1);
+  csr.row_ptr.push_back(0);
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      float x = m[static_cast<size_t>(i) * cols + j];
+      if (x != 0.0f) {
+        csr.col_idx.push_back(j);
+        csr.values.push_back(x);
+      }
+    }
+    csr.row_ptr.push_back(static_cast<int>(csr.values.size()));
+  }
+  return csr;
+}
+
+// Scalar CSR kernel for rows [begin, end)
+inline void spmv_csr_scalar(const CsrMatrix &a, const float *v, float *r,
+                            int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    float tmp = 0;
+    for (int k = a.row_ptr[i]; k < a.row_ptr[i + 1]; k++) {
+      tmp += a.values[k] * v[a.col_idx[k]];
+    }
+    r[i] = tmp;
+  }
+}
+
+// AVX2 CSR kernel for rows [begin, end) (gathers 8 entries of v at a time)
+__attribute__((target("avx2,fma"))) inline void spmv_csr_avx2(
+    const CsrMatrix &a, const float *v, float *r, int begin, int end) {
+  const int *col = a.col_idx.data();
+  const float *val = a.values.data();
+  for (int i = begin; i < end; i++) {
+    int k = a.row_ptr[i];
+    int row_end = a.row_ptr[i + 1];
+
+    // Two accumulators so back-to-back gathers don't serialize on one FMA
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; k + 16 <= row_end; k += 16) {
+      __m256i idx0 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col + k));
+      __m256i idx1 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col + k + 8));
+      acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(val + k),
+                             _mm256_i32gather_ps(v, idx0, 4), acc0);
+      acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(val + k + 8),
+                             _mm256_i32gather_ps(v, idx1, 4), acc1);
+    }
+    for (; k + 8 <= row_end; k += 8) {
+      __m256i idx =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col + k));
+      acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(val + k),
+                             _mm256_i32gather_ps(v, idx, 4), acc0);
+    }
+
+    // Masked tail (masked-off lanes are neither loaded nor gathered)
+    if (k < row_end) {
+      __m256i mask = tail_mask_avx2(row_end - k);
+      __m256i idx = _mm256_maskload_epi32(col + k, mask);
+      __m256 x = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), v, idx,
+                                          _mm256_castsi256_ps(mask), 4);
+      acc1 = _mm256_fmadd_ps(_mm256_maskload_ps(val + k, mask), x, acc1);
+    }
+    r[i] = hsum_avx2(_mm256_add_ps(acc0, acc1));
+  }
+}
+
+// SELL-C-sigma ------------------------------------------------------------
+
+struct SellMatrix {
+  int rows = 0;
+  int cols = 0;
+  int chunk_size = 8;              // C (rows per chunk)
+  int sigma = 1;                   // Sorting window (in rows)
+  std::vector<int> perm;           // Slot -> original row
+  std::vector<int> chunk_ptr;      // Offset of each chunk in col_idx/values
+  std::vector<int> chunk_len;      // Width (longest row) of each chunk
+  std::vector<int> col_idx;        // Padding entries point at column 0
+  std::vector<float> values;       // Padding entries are 0
+  int num_chunks() const { return static_cast<int>(chunk_len.size()); }
+};
+
+// Build a SELL-C-sigma matrix from CSR
+inline SellMatrix csr_to_sell(const CsrMatrix &a, int chunk_size = 8,
+                              int sigma = 256) {
+  SellMatrix s;
+  s.rows = a.rows;
+  s.cols = a.cols;
+  s.chunk_size = chunk_size;
+  s.sigma = sigma;
+
+  // Sort rows by length (longest first) inside each window of sigma rows
+  auto length = [&](int i) { return a.row_ptr[i + 1] - a.row_ptr[i]; };
+  s.perm.resize(a.rows);
+  std::iota(s.perm.begin(), s.perm.end(), 0);
+  for (int w = 0; w < a.rows; w += sigma) {
+    auto first = s.perm.begin() + w;
+    auto last = s.perm.begin() + std::min(a.rows, w + sigma);
+    std::stable_sort(first, last,
+                     [&](int x, int y) { return length(x) > length(y); });
+  }
+
+  // Size each chunk by its longest row
+  int chunks = (a.rows + chunk_size - 1) / chunk_size;
+  s.chunk_ptr.resize(chunks + 1);
+  s.chunk_len.resize(chunks);
+  s.chunk_ptr[0] = 0;
+  for (int c = 0; c < chunks; c++) {
+    int width = 0;
+    for (int lane = 0; lane < chunk_size; lane++) {
+      int slot = c * chunk_size + lane;
+      if (slot < a.rows) width = std::max(width, length(s.perm[slot]));
+    }
+    s.chunk_len[c] = width;
+    s.chunk_ptr[c + 1] = s.chunk_ptr[c] + width * chunk_size;
+  }
+
+  // Fill each chunk column-by-column (lane = row within the chunk)
+  s.col_idx.assign(s.chunk_ptr[chunks], 0);
+  s.values.assign(s.chunk_ptr[chunks], 0.0f);
+  for (int c = 0; c < chunks; c++) {
+    for (int lane = 0; lane < chunk_size; lane++) {
+      int slot = c * chunk_size + lane;
+      if (slot >= a.rows) break;
+      int row = s.perm[slot];
+      for (int k = 0; k < length(row); k++) {
+        int dst = s.chunk_ptr[c] + k * chunk_size + lane;
+        s.col_idx[dst] = a.col_idx[a.row_ptr[row] + k];
+        s.values[dst] = a.values[a.row_ptr[row] + k];
+      }
+    }
+  }
+  return s;
+}
+
+// Scalar SELL kernel for chunks [begin, end)
+inline void spmv_sell_scalar(const SellMatrix &a, const float *v, float *r,
+                             int begin, int end) {
+  const int C = a.chunk_size;
+  for (int c = begin; c < end; c++) {
+    for (int lane = 0; lane < C; lane++) {
+      int slot = c * C + lane;
+      if (slot >= a.rows) break;
+      float tmp = 0;
+      for (int k = 0; k < a.chunk_len[c]; k++) {
+        int idx = a.chunk_ptr[c] + k * C + lane;
+        tmp += a.values[idx] * v[a.col_idx[idx]];
+      }
+      r[a.perm[slot]] = tmp;
+    }
+  }
+}
+
+// AVX2 SELL-8 kernel for chunks [begin, end) (one lane per row, so there
+// is no horizontal reduction at all)
+__attribute__((target("avx2,fma"))) inline void spmv_sell8_avx2(
+    const SellMatrix &a, const float *v, float *r, int begin, int end) {
+  const int *col = a.col_idx.data();
+  const float *val = a.values.data();
+  for (int c = begin; c < end; c++) {
+    const int *cc = col + a.chunk_ptr[c];
+    const float *cv = val + a.chunk_ptr[c];
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 2 <= a.chunk_len[c]; k += 2) {
+      __m256i idx0 =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cc + k * 8));
+      __m256i idx1 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(cc + k * 8 + 8));
+      acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(cv + k * 8),
+                             _mm256_i32gather_ps(v, idx0, 4), acc0);
+      acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(cv + k * 8 + 8),
+                             _mm256_i32gather_ps(v, idx1, 4), acc1);
+    }
+    if (k < a.chunk_len[c]) {
+      __m256i idx =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cc + k * 8));
+      acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(cv + k * 8),
+                             _mm256_i32gather_ps(v, idx, 4), acc0);
+    }
+
+    // Scatter the 8 row results back to their original rows
+    alignas(32) float out[8];
+    _mm256_store_ps(out, _mm256_add_ps(acc0, acc1));
+    int lanes = std::min(8, a.rows - c * 8);
+    for (int lane = 0; lane < lanes; lane++) {
+      r[a.perm[c * 8 + lane]] = out[lane];
+    }
+  }
+}
+
+// Dispatch --------------------------------------------------------------
+
+inline bool spmv_avx2_supported() {
+  static const bool supported = gemv_isa_supported(GemvIsa::avx2);
+  return supported;
+}
+
+// r = a * v
+inline void spmv(const CsrMatrix &a, const float *v, float *r) {
+  if (spmv_avx2_supported()) {
+    spmv_csr_avx2(a, v, r, 0, a.rows);
+  } else {
+    spmv_csr_scalar(a, v, r, 0, a.rows);
+  }
+}
+
+inline void spmv(const SellMatrix &a, const float *v, float *r) {
+  if (spmv_avx2_supported() && a.chunk_size == 8) {
+    spmv_sell8_avx2(a, v, r, 0, a.num_chunks());
+  } else {
+    spmv_sell_scalar(a, v, r, 0, a.num_chunks());
+  }
+}
+
+// Threaded versions ------------------------------------------------------
+
+// Split the rows so every thread gets about the same number of non-zeros
+inline std::vector<int> balance_csr_rows(const CsrMatrix &a, int parts) {
+  std::vector<int> bounds(parts + 1, a.rows);
+  bounds[0] = 0;
+  long long nnz = a.row_ptr[a.rows];
+  for (int p = 1; p < parts; p++) {
+    long long target = nnz * p / parts;
+    bounds[p] = static_cast<int>(
+        std::lower_bound(a.row_ptr.begin(), a.row_ptr.end(), target) -
+        a.row_ptr.begin());
+    bounds[p] = std::max(bounds[p], bounds[p - 1]);
+  }
+  return bounds;
+}
+
+inline void spmv(ThreadPool &pool, const CsrMatrix &a,
+                 const std::vector<int> &bounds, const float *v, float *r) {
+  const bool simd = spmv_avx2_supported();
+  pool.run([&](int id) {
+    if (simd) {
+      spmv_csr_avx2(a, v, r, bounds[id], bounds[id + 1]);
+    } else {
+      spmv_csr_scalar(a, v, r, bounds[id], bounds[id + 1]);
+    }
+  });
+}
+
+// Chunks are already padded to the same shape, so split them evenly
+inline void spmv(ThreadPool &pool, const SellMatrix &a, const float *v,
+                 float *r) {
+  const bool simd = spmv_avx2_supported() && a.chunk_size == 8;
+  pool.run([&](int id) {
+    auto chunks = split_range(a.num_chunks(), pool.size(), id);
+    if (simd) {
+      spmv_sell8_avx2(a, v, r, chunks.first, chunks.second);
+    } else {
+      spmv_sell_scalar(a, v, r, chunks.first, chunks.second);
+    }
+  });
+}
@@ -0,0 +1,209 @@
+// This program benchmarks sparse matrix-vector multiplication (CSR and
+// SELL-C-sigma) against the dense kernel across a range of densities
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "spmv.h"
+
+using namespace std;
+
+// Matrix size for every benchmark (64 MB when dense)
+const int dim = 1 << 12;
+
+// Dense row-major matrix where roughly density_pm / 1000 of the entries
+// are non-zero
+static vector<float> randomSparse(int density_pm) {
+  vector<float> m(size_t(dim) * dim, 0.0f);
+  for (auto &x : m) {
+    if (rand() % 1000 < density_pm) x = rand() % 100 + 1;
+  }
+  return m;
+}
+
+static vector<float> randomVector() {
+  vector<float> v(dim);
+  for (auto &x : v) x = rand() % 100;
+  return v;
+}
+
+// Items are non-zeros for all benchmarks so they're directly comparable
+static void setCounters(benchmark::State &s, size_t nnz, size_t bytes) {
+  s.SetItemsProcessed(int64_t(nnz) * s.iterations());
+  s.SetBytesProcessed(int64_t(bytes) * s.iterations());
+  s.counters["density_%"] = 100.0 * nnz / (double(dim) * dim);
+}
+
+// Does r match the dense kernel's result for m * v? (The sums are done in
+// a different order, so allow some rounding)
+static bool matchesDense(const vector<float> &m, const vector<float> &v,
+                         const vector<float> &r) {
+  vector<float> ref(dim);
+  matrix_vector(m.data(), v.data(), ref.data(), dim);
+  for (int i = 0; i < dim; i++) {
+    if (fabs(r[i] - ref[i]) > 1e-5f * fabs(ref[i])) return false;
+  }
+  return true;
+}
+
+// Dense kernel on the same matrix (zeros and all)
+static void denseBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  size_t nnz = dim * size_t(dim) - count(m.begin(), m.end(), 0.0f);
+
+  while (s.KeepRunning()) {
+    matrix_vector(m.data(), v.data(), r.data(), dim);
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, nnz, sizeof(float) * size_t(dim) * (dim + 2));
+}
+
+// CSR (scalar or AVX2 gather, depending on the CPU)
+static void csrBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  CsrMatrix a = dense_to_csr(m.data(), dim, dim);
+
+  // Check against the dense result before timing anything
+  spmv(a, v.data(), r.data());
+  if (!matchesDense(m, v, r)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    spmv(a, v.data(), r.data());
+    benchmark::ClobberMemory();
+  }
+  size_t nnz = a.values.size();
+  setCounters(s, nnz, (sizeof(float) + sizeof(int)) * nnz +
+                          sizeof(int) * (dim + 1) + sizeof(float) * 2 * dim);
+}
+
+// CSR with the plain scalar loop (to see what the gathers buy us)
+static void csrScalarBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  CsrMatrix a = dense_to_csr(m.data(), dim, dim);
+
+  // Check against the dense result before timing anything
+  spmv_csr_scalar(a, v.data(), r.data(), 0, a.rows);
+  if (!matchesDense(m, v, r)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    spmv_csr_scalar(a, v.data(), r.data(), 0, a.rows);
+    benchmark::ClobberMemory();
+  }
+  size_t nnz = a.values.size();
+  setCounters(s, nnz, (sizeof(float) + sizeof(int)) * nnz +
+                          sizeof(int) * (dim + 1) + sizeof(float) * 2 * dim);
+}
+
+// SELL-8-256
+static void sellBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  CsrMatrix csr = dense_to_csr(m.data(), dim, dim);
+  SellMatrix a = csr_to_sell(csr, 8, 256);
+
+  // Check against the dense result before timing anything
+  spmv(a, v.data(), r.data());
+  if (!matchesDense(m, v, r)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    spmv(a, v.data(), r.data());
+    benchmark::ClobberMemory();
+  }
+
+  // Padding entries are streamed too, so count them in the bytes
+  setCounters(s, csr.values.size(),
+              (sizeof(float) + sizeof(int)) * a.values.size() +
+                  sizeof(int) * (dim + 2 * a.num_chunks()) +
+                  sizeof(float) * 2 * dim);
+}
+
+// Threaded CSR and SELL (one thread per core)
+static void csrThreadedBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  CsrMatrix a = dense_to_csr(m.data(), dim, dim);
+  ThreadPool pool(max(1u, thread::hardware_concurrency()));
+  auto bounds = balance_csr_rows(a, pool.size());
+
+  // Check against the dense result before timing anything
+  spmv(pool, a, bounds, v.data(), r.data());
+  if (!matchesDense(m, v, r)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    spmv(pool, a, bounds, v.data(), r.data());
+    benchmark::ClobberMemory();
+  }
+  size_t nnz = a.values.size();
+  setCounters(s, nnz, (sizeof(float) + sizeof(int)) * nnz +
+                          sizeof(int) * (dim + 1) + sizeof(float) * 2 * dim);
+}
+
+static void sellThreadedBench(benchmark::State &s) {
+  auto m = randomSparse(s.range(0));
+  auto v = randomVector();
+  vector<float> r(dim);
+  CsrMatrix csr = dense_to_csr(m.data(), dim, dim);
+  SellMatrix a = csr_to_sell(csr, 8, 256);
+  ThreadPool pool(max(1u, thread::hardware_concurrency()));
+
+  // Check against the dense result before timing anything
+  spmv(pool, a, v.data(), r.data());
+  if (!matchesDense(m, v, r)) {
+    s.SkipWithError("Incorrect result");
+    return;
+  }
+
+  while (s.KeepRunning()) {
+    spmv(pool, a, v.data(), r.data());
+    benchmark::ClobberMemory();
+  }
+  setCounters(s, csr.values.size(),
+              (sizeof(float) + sizeof(int)) * a.values.size() +
+                  sizeof(int) * (dim + 2 * a.num_chunks()) +
+                  sizeof(float) * 2 * dim);
+}
+
+// Densities in parts per thousand (0.5% up to 50%)
+static void Densities(benchmark::internal::Benchmark *b) {
+  for (int pm : {5, 10, 50, 100, 200, 300, 500}) b->Arg(pm);
+}
+
+// Register the benchmarks
+BENCHMARK(denseBench)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(csrScalarBench)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(csrBench)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(sellBench)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(csrThreadedBench)
+    ->Apply(Densities)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(sellThreadedBench)
+    ->Apply(Densities)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Benchmark main function
+BENCHMARK_MAIN();
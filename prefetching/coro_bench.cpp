@@ -0,0 +1,191 @@
+// This program runs random lookups with the coroutine executor, and
+// compares them with plain loops:
+//   - random: v_out[v_in[i]]++ over shuffled indices (random in
+//     prefetching.cpp), where a lookup is one prefetch and one update
+//   - multiHop: a chained hash table probe (hash the key, load the
+//     bucket, then follow records until the key matches), where only the
+//     first address is known up front
+// The second argument of the coroutine benchmarks is G, the number of
+// lookups in flight
+// Build: g++ -std=c++20 -O3 -march=native coro_bench.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "../common/huge_pages.h"
+#include "coro_executor.h"
+
+// Shuffled indices 0..n-1
+static std::vector<int> randomIndices(int n) {
+  std::vector<int> v_in(n);
+  std::iota(begin(v_in), end(v_in), 0);
+  std::mt19937 urng(42);
+  std::shuffle(begin(v_in), end(v_in), urng);
+  return v_in;
+}
+
+// Lookups in flight
+static const std::vector<int64_t> groups = {1, 2, 4, 8, 12, 16, 24, 32};
+
+// The direct loop from prefetching.cpp
+static void random(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    for (int i = 0; i < N * N; i++) {
+      v_out[v_in[i]]++;
+    }
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK(random)->DenseRange(10, 12)->Unit(benchmark::kMillisecond);
+
+// One increment per coroutine
+static Lookup increment(int *out) {
+  co_await prefetch{out};
+  (*out)++;
+}
+
+// The same thing with G increments in flight
+static void randomCoro(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+  const int G = s.range(1);
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    run_interleaved(v_in.size(), G,
+                    [&](size_t i) { return increment(&v_out[v_in[i]]); });
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK(randomCoro)
+    ->ArgsProduct({benchmark::CreateDenseRange(10, 12, 1), groups})
+    ->Unit(benchmark::kMillisecond);
+
+// A chained hash table (two keys per bucket on average) with one cache
+// line per bucket and per record, on 2 MiB pages so we measure the misses
+// and not the page walks. Records are in random order, so every hop is a
+// miss, and how many hops a probe takes depends on the data.
+constexpr uint32_t none = ~0u;
+
+struct alignas(64) Bucket {
+  uint32_t head;
+};
+
+struct alignas(64) Record {
+  uint32_t key;
+  uint32_t next;
+  uint64_t value;
+};
+
+struct HashTable {
+  explicit HashTable(int log2_n)
+      : buckets(size_t(1) << (log2_n - 1), page_2m),
+        records(size_t(1) << log2_n, page_2m),
+        shift(32 - (log2_n - 1)) {
+    const int n = 1 << log2_n;
+    for (auto &b : buckets) b.head = none;
+    auto order = randomIndices(n);
+    for (int key = 0; key < n; key++) {
+      Bucket &b = buckets[slot(key)];
+      records[order[key]] = {uint32_t(key), b.head, uint64_t(key) * 3};
+      b.head = order[key];
+    }
+
+    // Random keys to look up
+    std::mt19937 urng(7);
+    keys.resize(n);
+    for (auto &k : keys) k = urng() % n;
+  }
+
+  // Multiplicative hashing (top bits of key * golden ratio)
+  size_t slot(uint32_t key) const { return (key * 0x9e3779b1u) >> shift; }
+
+  HugeBuffer<Bucket> buckets;
+  HugeBuffer<Record> records;
+  int shift;
+  std::vector<uint32_t> keys;
+};
+
+// Plain loop (for each key: hash, bucket, then records until the key
+// matches)
+static void multiHop(benchmark::State &s) {
+  HashTable table(s.range(0));
+  const size_t n = table.keys.size();
+  std::vector<uint64_t> results(n);
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    for (size_t i = 0; i < n; i++) {
+      uint32_t key = table.keys[i];
+      uint32_t r = table.buckets[table.slot(key)].head;
+      while (table.records[r].key != key) r = table.records[r].next;
+      results[i] = table.records[r].value;
+    }
+    benchmark::DoNotOptimize(results.data());
+  }
+  s.SetItemsProcessed(int64_t(n) * s.iterations());
+}
+BENCHMARK(multiHop)->DenseRange(20, 24, 2)->Unit(benchmark::kMillisecond);
+
+// One probe per coroutine, prefetching each hop before we need it
+static Lookup probe(const HashTable &table, uint32_t key, uint64_t *result) {
+  const Bucket *b = &table.buckets[table.slot(key)];
+  co_await prefetch{b};
+  for (uint32_t r = b->head;;) {
+    const Record *record = &table.records[r];
+    co_await prefetch{record};
+    if (record->key == key) {
+      *result = record->value;
+      co_return;
+    }
+    r = record->next;
+  }
+}
+
+static void multiHopCoro(benchmark::State &s) {
+  HashTable table(s.range(0));
+  const int G = s.range(1);
+  const size_t n = table.keys.size();
+  std::vector<uint64_t> results(n);
+
+  // Make sure every probe finds its record
+  run_interleaved(n, G, [&](size_t i) {
+    return probe(table, table.keys[i], &results[i]);
+  });
+  for (size_t i = 0; i < n; i++) {
+    if (results[i] != uint64_t(table.keys[i]) * 3) {
+      s.SkipWithError("Incorrect result");
+      break;
+    }
+  }
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    run_interleaved(n, G, [&](size_t i) {
+      return probe(table, table.keys[i], &results[i]);
+    });
+    benchmark::DoNotOptimize(results.data());
+  }
+  s.SetItemsProcessed(int64_t(n) * s.iterations());
+}
+BENCHMARK(multiHopCoro)
+    ->ArgsProduct({benchmark::CreateDenseRange(20, 24, 2), groups})
+    ->Unit(benchmark::kMillisecond);
+
+// Benchmark main functions
+BENCHMARK_MAIN();
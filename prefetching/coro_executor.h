@@ -0,0 +1,162 @@
+// Interleaved execution of lookups with C++20 coroutines (asynchronous
+// memory access chaining, AMAC). A prefetch hint only helps if we know the
+// address early, and for a multi-step lookup (hash -> bucket -> record)
+// we only learn the next address once the last load is back. So instead
+// each lookup is a coroutine that prefetches what it needs next and
+// suspends (co_await prefetch(p)), and the scheduler keeps a group of G
+// lookups going round-robin: while one waits on its miss, the others
+// issue theirs.
+//
+// Coroutine frames come from a per-thread free list, so starting a lookup
+// doesn't go to malloc every time.
+// Needs -std=c++20
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Recycles coroutine frames through an intrusive free list (lookups of
+// the same kind all have the same frame size, so one size class is
+// enough). The list is plain thread_local data, so using it needs no
+// thread_local initialization checks. Frames still on the list when a
+// thread exits (at most one group's worth) are not given back.
+class CoroFramePool {
+ public:
+  static void *allocate(size_t size) {
+    Free &f = list();
+    if (size == f.size && f.head) {
+      Node *node = f.head;
+      f.head = node->next;
+      return node;
+    }
+    return ::operator new(std::max(size, sizeof(Node)));
+  }
+
+  static void deallocate(void *p, size_t size) {
+    Free &f = list();
+    // Switch to the new size class if the frame size changes
+    if (size != f.size) {
+      while (f.head) {
+        Node *node = f.head;
+        f.head = node->next;
+        ::operator delete(node);
+      }
+      f.size = size;
+    }
+    f.head = new (p) Node{f.head};
+  }
+
+ private:
+  struct Node {
+    Node *next;
+  };
+  struct Free {
+    Node *head;
+    size_t size;
+  };
+  static Free &list() {
+    static thread_local Free f{nullptr, 0};
+    return f;
+  }
+};
+
+// A lookup: a coroutine that runs up to its first co_await when it's
+// created (usually hashing and prefetching its first address), and is then
+// driven by the scheduler until it finishes
+class Lookup {
+ public:
+  struct promise_type {
+    Lookup get_return_object() {
+      return Lookup(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+
+    static void *operator new(size_t size) {
+      return CoroFramePool::allocate(size);
+    }
+    static void operator delete(void *p, size_t size) {
+      CoroFramePool::deallocate(p, size);
+    }
+  };
+
+  Lookup() = default;
+  explicit Lookup(std::coroutine_handle<promise_type> h) : handle(h) {}
+  Lookup(Lookup &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+  Lookup &operator=(Lookup &&other) noexcept {
+    if (this != &other) {
+      if (handle) handle.destroy();
+      handle = std::exchange(other.handle, {});
+    }
+    return *this;
+  }
+  Lookup(const Lookup &) = delete;
+  Lookup &operator=(const Lookup &) = delete;
+  ~Lookup() {
+    if (handle) handle.destroy();
+  }
+
+  // Has it run to the end?
+  bool done() const { return handle.done(); }
+
+  // Run until the next suspension point. Returns false once it's finished
+  bool resume() {
+    handle.resume();
+    return !handle.done();
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+// co_await prefetch(p): start loading p's cache line and let the other
+// lookups run while it arrives
+struct prefetch {
+  const void *address;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<>) const noexcept {
+    __builtin_prefetch(address);
+  }
+  void await_resume() const noexcept {}
+};
+
+// Runs lookup(i) for every i in [0, n), keeping group lookups in flight.
+// When one finishes, the next one takes its slot. group = 1 runs them one
+// after another (with the coroutine overhead, but no overlap).
+template <typename F>
+void run_interleaved(size_t n, int group, F &&lookup) {
+  std::vector<Lookup> slots(group);
+  size_t next = 0;
+  int active = 0;
+
+  // Start the next lookup that doesn't finish right away in slot g
+  auto refill = [&](int g) {
+    while (next < n) {
+      slots[g] = lookup(next++);
+      if (!slots[g].done()) return true;
+    }
+    return false;
+  };
+  while (active < group && refill(active)) active++;
+
+  while (active > 0) {
+    for (int g = 0; g < active;) {
+      if (slots[g].resume() || refill(g)) {
+        g++;
+      } else {
+        // Nothing left to start, so close the gap
+        slots[g] = std::move(slots[--active]);
+      }
+    }
+  }
+}
@@ -0,0 +1,128 @@
+// Software prefetching for indirect loops (work on target[index[i]]),
+// where the hardware prefetcher can't guess the next address.
+//   - indirect_prefetch_loop prefetches target[index[i + distance]] while
+//     working on element i, and never reads index past the end
+//   - PrefetchTuner picks the distance by timing short windows of the
+//     real loop, then keeps checking its neighbours while the loop runs
+//     (the best distance depends on memory latency and on how much work
+//     each element takes, so no fixed number is right everywhere)
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// body(i) for i in [begin, end), prefetching the target element distance
+// iterations ahead (distance 0 means no prefetching). RW and Locality are
+// passed on to __builtin_prefetch.
+template <int RW = 0, int Locality = 3, typename Index, typename T,
+          typename F>
+inline void indirect_prefetch_loop(const Index *index, T *target,
+                                   size_t begin, size_t end, size_t distance,
+                                   F &&body) {
+  size_t i = begin;
+  if (distance > 0 && end - begin > distance) {
+    for (; i < end - distance; i++) {
+      __builtin_prefetch(&target[index[i + distance]], RW, Locality);
+      body(i);
+    }
+  }
+
+  // Nothing left to prefetch for the last few
+  for (; i < end; i++) body(i);
+}
+
+class PrefetchTuner {
+ public:
+  // Distances we try (sorted, so neighbours are next to each other)
+  static std::vector<int> default_distances() {
+    return {0, 1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64};
+  }
+
+  explicit PrefetchTuner(size_t window = 1 << 14,
+                         std::vector<int> distances = default_distances(),
+                         int windows_per_check = 64)
+      : window(std::max<size_t>(window, 1)),
+        distances(std::move(distances)),
+        times(this->distances.size(), 0),
+        windows_per_check(windows_per_check) {}
+
+  // Current best distance
+  int distance() const { return distances[current]; }
+
+  // Have we timed every distance (twice) yet?
+  bool tuned() const { return trials >= 2 * distances.size(); }
+
+  // body(i) for every i in [0, n), one window at a time. Until every
+  // distance has been timed twice, each window tries the next one. After
+  // that we mostly run the best distance, but every windows_per_check
+  // windows we try a neighbour of it instead, and move over if it's faster.
+  template <int RW = 0, int Locality = 3, typename Index, typename T,
+            typename F>
+  void run(const Index *index, T *target, size_t n, F &&body) {
+    for (size_t begin = 0; begin < n; begin += window) {
+      size_t end = std::min(n, begin + window);
+      size_t trial = pick();
+
+      auto start = std::chrono::steady_clock::now();
+      indirect_prefetch_loop<RW, Locality>(index, target, begin, end,
+                                           distances[trial], body);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+      // Only full windows are comparable
+      if (end - begin == window) record(trial, elapsed.count());
+    }
+  }
+
+ private:
+  // Which distance to use for the next window
+  size_t pick() {
+    if (!tuned()) return trials % distances.size();
+    if (++windows < windows_per_check) return current;
+    windows = 0;
+    probe_up = !probe_up;
+    if (probe_up && current + 1 < distances.size()) return current + 1;
+    if (!probe_up && current > 0) return current - 1;
+    return current;
+  }
+
+  // While tuning keep the best time per distance, and start from the best
+  // of them. After that keep a slowly-forgetting average, so we follow
+  // changes in the machine (or the data) without jumping on one noisy
+  // window. The averages start over from scratch (a best-of-two minimum
+  // would beat any average), and we only ever compare the neighbour we
+  // just probed with the current distance.
+  void record(size_t trial, double seconds) {
+    double &t = times[trial];
+    if (!tuned()) {
+      t = t == 0 ? seconds : std::min(t, seconds);
+      trials++;
+      if (!tuned()) return;
+      for (size_t d = 0; d < distances.size(); d++) {
+        if (times[d] > 0 && times[d] < times[current]) current = d;
+      }
+      std::fill(times.begin(), times.end(), 0.0);
+      return;
+    }
+    bool first = t == 0;
+    t = first ? seconds : 0.75 * t + 0.25 * seconds;
+
+    // A neighbour's first window only starts its average
+    if (first || trial == current || times[current] == 0) return;
+    if (t < times[current]) current = trial;
+  }
+
+  size_t window;
+  std::vector<int> distances;
+  std::vector<double> times;  // Seconds per window for each distance
+  int windows_per_check;
+  size_t trials = 0;
+  size_t current = 0;
+  int windows = 0;
+  bool probe_up = false;
+};
@@ -0,0 +1,97 @@
+// This program re-runs the access patterns from prefetching.cpp (row by
+// row, column by column, and a cache line's worth of tile at a time) on
+// N x N matrices stored in each layout of common/matrix2d.h
+// Build: g++ -O3 -march=native layout_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include "../common/matrix2d.h"
+
+// Walks the matrix row by row
+template <typename Layout>
+static void rowWalk(benchmark::State &s) {
+  // Input/output matrix size
+  int N = 1 << s.range(0);
+  Matrix2D<int, Layout> m(N, N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    for (int i = 0; i < N; i++) {
+      for (int &x : m.row(i)) x++;
+    }
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK_TEMPLATE(rowWalk, RowMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(rowWalk, ColumnMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(rowWalk, Tiled<>)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(rowWalk, Morton)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+
+// Walks the matrix column by column (columnMajor in prefetching.cpp)
+template <typename Layout>
+static void columnWalk(benchmark::State &s) {
+  // Input/output matrix size
+  int N = 1 << s.range(0);
+  Matrix2D<int, Layout> m(N, N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    for (int j = 0; j < N; j++) {
+      for (int &x : m.col(j)) x++;
+    }
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK_TEMPLATE(columnWalk, RowMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(columnWalk, ColumnMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(columnWalk, Tiled<>)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(columnWalk, Morton)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+
+// Walks the matrix one 4 x 4 tile (one cache line of ints) at a time
+template <typename Layout>
+static void tileWalk(benchmark::State &s) {
+  // Input/output matrix size
+  int N = 1 << s.range(0);
+  Matrix2D<int, Layout> m(N, N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    for (int i = 0; i < N; i += 4) {
+      for (int j = 0; j < N; j += 4) {
+        for (int &x : m.tile(i, j, 4, 4)) x++;
+      }
+    }
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK_TEMPLATE(tileWalk, RowMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tileWalk, ColumnMajor)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tileWalk, Tiled<>)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(tileWalk, Morton)
+    ->DenseRange(10, 12)
+    ->Unit(benchmark::kMillisecond);
+
+// Benchmark main functions
+BENCHMARK_MAIN();
@@ -0,0 +1,205 @@
+// Multi-threaded scatter increments (out[index[i]]++, a histogram), with
+// the indices split across a thread pool. Three ways to keep threads from
+// fighting over the output:
+//   - privatized: every thread counts into its own copy of the output,
+//     then the copies are summed into out (in parallel, with vector adds)
+//   - partitioned: every thread owns a contiguous range of the output.
+//     Threads first sort their indices by owner, then each owner applies
+//     the updates for its range
+//   - atomic: everyone updates out directly with atomic adds (the
+//     baseline, which pays for contention and for cache lines bouncing
+//     between cores like in false_sharing.cpp)
+// Privatizing is the fastest as long as the copies stay in cache, but
+// costs threads x the output in memory and merge work, so for large
+// outputs we switch to partitioning.
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../common/thread_pool.h"
+
+enum class ScatterStrategy { privatized, partitioned, atomic };
+
+inline const char *scatter_strategy_name(ScatterStrategy s) {
+  switch (s) {
+    case ScatterStrategy::privatized:
+      return "privatized";
+    case ScatterStrategy::partitioned:
+      return "partitioned";
+    case ScatterStrategy::atomic:
+      return "atomic";
+  }
+  return "unknown";
+}
+
+// Per-core L2 and last-level cache sizes in bytes (with guesses for when
+// the system won't say)
+struct CacheSizes {
+  size_t l2;
+  size_t llc;
+};
+
+inline CacheSizes cache_sizes() {
+  CacheSizes c{size_t(1) << 20, size_t(32) << 20};
+  long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (l2 > 0) c.l2 = l2;
+  if (l3 > 0) c.llc = l3;
+  c.llc = std::max(c.llc, c.l2);
+  return c;
+}
+
+// Privatize while each thread's copy fits in its L2, or all of the copies
+// fit in the last-level cache together. Otherwise partition.
+inline ScatterStrategy pick_scatter_strategy(
+    size_t out_bytes, int threads, const CacheSizes &cache = cache_sizes()) {
+  if (threads <= 1 || out_bytes <= cache.l2) {
+    return ScatterStrategy::privatized;
+  }
+  if (out_bytes * threads <= cache.llc) return ScatterStrategy::privatized;
+  return ScatterStrategy::partitioned;
+}
+
+template <typename T>
+class ParallelScatter {
+  static_assert(std::is_integral<T>::value, "counts must be integers");
+
+ public:
+  // Elements per vector in the merge (one cache line)
+  static constexpr size_t width = 64 / sizeof(T);
+
+  // Scatters into outputs of out_size elements using the pool's threads
+  ParallelScatter(ThreadPool &pool, size_t out_size)
+      : pool(pool),
+        out_size(out_size),
+        copies(pool.size()),
+        lists(size_t(pool.size()) * pool.size()) {}
+
+  // What increment() uses when no strategy is given
+  ScatterStrategy strategy() const {
+    return pick_scatter_strategy(out_size * sizeof(T), pool.size());
+  }
+
+  // out[index[i]]++ for every i in [0, n), with 0 <= index[i] < out_size
+  void increment(const int *index, size_t n, T *out) {
+    increment(index, n, out, strategy());
+  }
+
+  void increment(const int *index, size_t n, T *out, ScatterStrategy s) {
+    switch (s) {
+      case ScatterStrategy::privatized:
+        privatized(index, n, out);
+        break;
+      case ScatterStrategy::partitioned:
+        partitioned(index, n, out);
+        break;
+      case ScatterStrategy::atomic:
+        atomic(index, n, out);
+        break;
+    }
+  }
+
+ private:
+  // Bounds of thread id's share of [0, n), in multiples of align
+  std::pair<size_t, size_t> chunk(size_t n, int id, size_t align = 1) const {
+    size_t blocks = (n + align - 1) / align;
+    size_t begin = blocks * id / pool.size() * align;
+    size_t end = blocks * (id + 1) / pool.size() * align;
+    return {std::min(begin, n), std::min(end, n)};
+  }
+
+  void privatized(const int *index, size_t n, T *out) {
+    // One thread can count straight into out
+    if (pool.size() == 1) {
+      for (size_t i = 0; i < n; i++) out[index[i]]++;
+      return;
+    }
+
+    // Count into our own copy (allocated, and so first touched, by the
+    // thread that uses it). Copies are all zero between calls.
+    pool.run([&](int id) {
+      auto &copy = copies[id];
+      if (copy.size() != out_size) copy.assign(out_size, 0);
+      T *counts = copy.data();
+      auto range = chunk(n, id);
+      for (size_t i = range.first; i < range.second; i++) counts[index[i]]++;
+    });
+
+    // Sum the copies into out, a cache line at a time, and zero them again
+    // for the next call. Threads merge separate (whole) lines of out.
+    pool.run([&](int id) {
+      typedef T vec __attribute__((vector_size(64)));
+      auto range = chunk(out_size, id, width);
+      size_t j = range.first;
+      for (; j + width <= range.second; j += width) {
+        vec acc;
+        std::memcpy(&acc, out + j, sizeof(vec));
+        for (auto &copy : copies) {
+          vec v;
+          std::memcpy(&v, copy.data() + j, sizeof(vec));
+          acc += v;
+          std::memset(copy.data() + j, 0, sizeof(vec));
+        }
+        std::memcpy(out + j, &acc, sizeof(vec));
+      }
+      for (; j < range.second; j++) {
+        for (auto &copy : copies) {
+          out[j] += copy[j];
+          copy[j] = 0;
+        }
+      }
+    });
+  }
+
+  void partitioned(const int *index, size_t n, T *out) {
+    // Owners get whole cache lines of out
+    const int threads = pool.size();
+    const size_t blocks = (out_size + width - 1) / width;
+    const size_t owned = (blocks + threads - 1) / threads * width;
+
+    // Sort our share of the indices by owner
+    pool.run([&](int id) {
+      OwnerList *mine = &lists[size_t(id) * threads];
+      for (int t = 0; t < threads; t++) mine[t].indices.clear();
+      auto range = chunk(n, id);
+      for (size_t i = range.first; i < range.second; i++) {
+        mine[index[i] / owned].indices.push_back(index[i]);
+      }
+    });
+
+    // Apply everything sent to us
+    pool.run([&](int id) {
+      for (int t = 0; t < threads; t++) {
+        for (int idx : lists[size_t(t) * threads + id].indices) out[idx]++;
+      }
+    });
+  }
+
+  void atomic(const int *index, size_t n, T *out) {
+    pool.run([&](int id) {
+      auto range = chunk(n, id);
+      for (size_t i = range.first; i < range.second; i++) {
+        __atomic_fetch_add(&out[index[i]], 1, __ATOMIC_RELAXED);
+      }
+    });
+  }
+
+  // Indices one thread sends to one owner. Every push_back writes the
+  // vector's end pointer, so each one gets its own cache line (otherwise
+  // neighbouring threads' lists would false share).
+  struct alignas(64) OwnerList {
+    std::vector<int> indices;
+  };
+
+  ThreadPool &pool;
+  size_t out_size;
+  std::vector<std::vector<T>> copies;  // Per-thread counts (privatized)
+  std::vector<OwnerList> lists;  // [from][owner] (partitioned)
+};
@@ -0,0 +1,73 @@
+// This program compares the ways of running scatter increments
+// (v_out[v_in[i]]++) across threads: private copies merged at the end,
+// ownership of output ranges, atomics, and whichever one the output size
+// picks. We sweep the thread count and the output size (for a fixed
+// number of random updates)
+// Build: g++ -O3 -march=native parallel_scatter_bench.cpp -lbenchmark
+//        -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "parallel_scatter.h"
+
+// Updates per benchmark iteration
+constexpr int updates = 1 << 24;
+
+// Random indices into an output of n elements
+static std::vector<int> randomIndices(int n) {
+  std::vector<int> v_in(updates);
+  std::mt19937 urng(42);
+  std::uniform_int_distribution<int> dist(0, n - 1);
+  for (auto &i : v_in) i = dist(urng);
+  return v_in;
+}
+
+// First argument is the number of threads, second is log2 of the output
+// size. auto_pick uses whatever the scatter picks for the size.
+static void scatterBench(benchmark::State &s, ScatterStrategy strategy,
+                         bool auto_pick) {
+  const int threads = s.range(0);
+  const int N = 1 << s.range(1);
+
+  auto v_in = randomIndices(N);
+  std::vector<int> v_out(N);
+  ThreadPool pool(threads);
+  ParallelScatter<int> scatter(pool, v_out.size());
+  if (auto_pick) strategy = scatter.strategy();
+
+  // Make sure we get the same answer as a single thread
+  std::vector<int> expected(N);
+  for (int i : v_in) expected[i]++;
+  scatter.increment(v_in.data(), v_in.size(), v_out.data(), strategy);
+  if (v_out != expected) s.SkipWithError("Incorrect result");
+
+  // Region to profile
+  while (s.KeepRunning()) {
+    scatter.increment(v_in.data(), v_in.size(), v_out.data(), strategy);
+  }
+  s.SetItemsProcessed(int64_t(updates) * s.iterations());
+  s.SetLabel(scatter_strategy_name(strategy));
+}
+
+// Threads x output size (16 KB to 64 MB of ints)
+static void scatterArgs(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({{1, 2, 4, 8}, {12, 16, 20, 24}})
+      ->UseRealTime()
+      ->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_CAPTURE(scatterBench, privatized, ScatterStrategy::privatized,
+                  false)
+    ->Apply(scatterArgs);
+BENCHMARK_CAPTURE(scatterBench, partitioned, ScatterStrategy::partitioned,
+                  false)
+    ->Apply(scatterArgs);
+BENCHMARK_CAPTURE(scatterBench, atomic, ScatterStrategy::atomic, false)
+    ->Apply(scatterArgs);
+BENCHMARK_CAPTURE(scatterBench, auto, ScatterStrategy::privatized, true)
+    ->Apply(scatterArgs);
+
+// Benchmark main functions
+BENCHMARK_MAIN();
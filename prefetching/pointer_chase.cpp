@@ -0,0 +1,154 @@
+// This program measures memory latency and memory-level parallelism with
+// dependent loads. Every node sits in its own cache line and points to the
+// next one of a random single cycle (Sattolo's algorithm), so each load
+// has to wait for the one before it and the hardware prefetchers have
+// nothing to go on.
+//   - chaseLatency: one chain, over working sets from L1 to DRAM (and 4
+//     KiB or 2 MiB pages), reported as time per load
+//   - chaseChains<K>: K independent chains interleaved on one thread. The
+//     loads of different chains can overlap, so time per load drops until
+//     we run out of miss buffers. mlp is how many loads were in flight on
+//     average (the one-chain latency over the time per load)
+// Build: g++ -O3 -march=native pointer_chase.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../common/huge_pages.h"
+
+// One node per cache line
+struct alignas(64) Node {
+  Node *next;
+};
+
+// Loads per benchmark iteration (split across the chains)
+constexpr int loads = 1 << 20;
+
+// Links nodes into one random cycle (Sattolo's algorithm: every shuffle
+// step swaps with an element strictly below, so we get a single cycle
+// through all nodes instead of a bunch of small ones)
+static void randomCycle(HugeBuffer<Node> &nodes) {
+  std::vector<int> order(nodes.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::mt19937 urng(42);
+  for (size_t i = order.size() - 1; i > 0; i--) {
+    std::uniform_int_distribution<size_t> dist(0, i - 1);
+    std::swap(order[i], order[dist(urng)]);
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    nodes[order[i]].next = &nodes[order[(i + 1) % order.size()]];
+  }
+}
+
+// Follows K chains for steps steps each, moving heads along (so the next
+// call picks up where this one stopped)
+template <int K>
+static void chase(Node **heads, int steps) {
+  Node *p[K];
+  for (int c = 0; c < K; c++) p[c] = heads[c];
+  for (int i = 0; i < steps; i++) {
+#pragma GCC unroll 32
+    for (int c = 0; c < K; c++) p[c] = p[c]->next;
+  }
+  for (int c = 0; c < K; c++) heads[c] = p[c];
+  benchmark::DoNotOptimize(heads);
+}
+
+// Which level of the cache hierarchy a working set fits in
+static const char *cacheLevel(size_t bytes) {
+  long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+  long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (l1 > 0 && bytes <= size_t(l1)) return "L1";
+  if (l2 > 0 && bytes <= size_t(l2)) return "L2";
+  if (l3 > 0 && bytes <= size_t(l3)) return "LLC";
+  return "DRAM";
+}
+
+// Time per load as a counter (loads per second, inverted)
+static benchmark::Counter perLoad(benchmark::State &s) {
+  return benchmark::Counter(double(loads) * s.iterations(),
+                            benchmark::Counter::kIsRate |
+                                benchmark::Counter::kInvert);
+}
+
+// One chain through 2^range(0) bytes, on pages of range(1) KB
+static void chaseLatency(benchmark::State &s) {
+  const size_t bytes = size_t(1) << s.range(0);
+  HugeBuffer<Node> nodes(bytes / sizeof(Node), size_t(s.range(1)) << 10);
+  randomCycle(nodes);
+
+  // Region to profile
+  Node *head = &nodes[0];
+  while (s.KeepRunning()) {
+    chase<1>(&head, loads);
+  }
+
+  s.counters["s_per_load"] = perLoad(s);
+  s.counters["page_KB"] = nodes.page_size() >> 10;
+  s.SetLabel(cacheLevel(bytes));
+}
+BENCHMARK(chaseLatency)
+    ->ArgsProduct({benchmark::CreateDenseRange(12, 30, 2), {4, 2048}})
+    ->Unit(benchmark::kMillisecond);
+
+// K chains through 2^range(0) bytes (on 2 MiB pages, so we're measuring
+// the memory and not the page walks)
+template <int K>
+static void chaseChains(benchmark::State &s) {
+  const size_t bytes = size_t(1) << s.range(0);
+  HugeBuffer<Node> nodes(bytes / sizeof(Node), page_2m);
+  randomCycle(nodes);
+
+  // Start the chains evenly spaced along the cycle, so they don't run
+  // into each other's (cached) nodes
+  Node *heads[K];
+  Node *p = &nodes[0];
+  const size_t spacing = nodes.size() / K;
+  for (int c = 0; c < K; c++) {
+    heads[c] = p;
+    for (size_t i = 0; i < spacing; i++) p = p->next;
+  }
+
+  // Latency of a single chain, for the mlp estimate (after a pass to
+  // warm up whatever of the working set fits in the caches)
+  Node *single = heads[0];
+  chase<1>(&single, loads);
+  auto start = std::chrono::steady_clock::now();
+  chase<1>(&single, loads);
+  std::chrono::duration<double> latency =
+      (std::chrono::steady_clock::now() - start) / loads;
+
+  // Region to profile
+  auto begin = std::chrono::steady_clock::now();
+  while (s.KeepRunning()) {
+    chase<K>(heads, loads / K);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - begin;
+
+  s.counters["s_per_load"] = perLoad(s);
+  s.counters["mlp"] =
+      latency.count() / (elapsed.count() / (double(loads) * s.iterations()));
+  s.SetLabel(cacheLevel(bytes));
+}
+
+// LLC and DRAM sized working sets
+static void chainSizes(benchmark::internal::Benchmark *b) {
+  b->DenseRange(24, 30, 2)->Unit(benchmark::kMillisecond);
+}
+BENCHMARK_TEMPLATE(chaseChains, 1)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 2)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 4)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 8)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 12)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 16)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 24)->Apply(chainSizes);
+BENCHMARK_TEMPLATE(chaseChains, 32)->Apply(chainSizes);
+
+// Benchmark main functions
+BENCHMARK_MAIN();
@@ -0,0 +1,67 @@
+// This program sweeps the software prefetch distance for a random
+// indirect access loop (like randomPrefetch in prefetching.cpp), and
+// shows where the self-tuning prefetcher lands compared with the best
+// fixed distance
+// Build: g++ -O3 -march=native prefetch_distance.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "indirect_prefetch.h"
+
+// Shuffled indices 0..n-1
+static std::vector<int> randomIndices(int n) {
+  std::vector<int> v_in(n);
+  std::iota(begin(v_in), end(v_in), 0);
+  std::mt19937 urng(42);
+  std::shuffle(begin(v_in), end(v_in), urng);
+  return v_in;
+}
+
+// Fixed prefetch distance from the second argument (0 = no prefetching)
+static void fixedDistance(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+  const int distance = s.range(1);
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    indirect_prefetch_loop(v_in.data(), v_out.data(), 0, v_in.size(),
+                           distance, [&](size_t i) { v_out[v_in[i]]++; });
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK(fixedDistance)
+    ->ArgsProduct({{11, 12}, {0, 1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64}})
+    ->Unit(benchmark::kMillisecond);
+
+// Let the tuner pick (it keeps its state from one iteration to the next,
+// so the early iterations include the search)
+static void tunedDistance(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+  PrefetchTuner tuner;
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    tuner.run(v_in.data(), v_out.data(), v_in.size(),
+              [&](size_t i) { v_out[v_in[i]]++; });
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+
+  // Where it ended up
+  s.counters["distance"] = tuner.distance();
+}
+BENCHMARK(tunedDistance)->DenseRange(11, 12)->Unit(benchmark::kMillisecond);
+
+// Benchmark main functions
+BENCHMARK_MAIN();
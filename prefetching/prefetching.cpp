@@ -7,6 +7,9 @@
 #include <numeric>
 #include <random>
 #include <vector>
+#include "../common/huge_pages.h"
+#include "../common/perf_counter.h"
+#include "indirect_prefetch.h"
 
 // Accesses an array sequentially in row-major fashion
 static void rowMajor(benchmark::State &s) {
@@ -151,7 +154,26 @@ static void columnMajor(benchmark::State &s) {
 // Register the benchmark
 BENCHMARK(columnMajor)->DenseRange(10, 12)->Unit(benchmark::kMillisecond);
 
-// Accesses an array in randomized order
+// Page sizes (in KB) for the random benchmarks: 4 KiB, 2 MiB and 1 GiB
+static void pageSizes(benchmark::internal::Benchmark *b) {
+  b->ArgsProduct({benchmark::CreateDenseRange(10, 12, 1), {4, 2048, 1 << 20}})
+      ->Unit(benchmark::kMillisecond);
+}
+
+// Report the pages v_out actually got, and the TLB misses per access (if
+// we can count them)
+static void reportPages(benchmark::State &s, const HugeBuffer<int> &v_out,
+                        const PerfCounter &tlb_misses) {
+  s.SetLabel(page_backing_name(v_out.backing()));
+  s.counters["page_KB"] = v_out.page_size() >> 10;
+  if (tlb_misses.valid()) {
+    s.counters["dTLB_miss_per_access"] =
+        double(tlb_misses.read()) / (double(v_out.size()) * s.iterations());
+  }
+}
+
+// Accesses an array in randomized order (the output is on pages of the
+// second argument's KB)
 static void random(benchmark::State &s) {
   // Input/output vector size
   int N = 1 << s.range(0);
@@ -166,17 +188,21 @@ static void random(benchmark::State &s) {
   std::shuffle(begin(v_in), end(v_in), urng);
 
   // Create an output vector
-  std::vector<int> v_out(N * N);
+  HugeBuffer<int> v_out(N * N, size_t(s.range(1)) << 10);
+  auto tlb_misses = PerfCounter::dtlb_load_misses();
 
   // Profile a simple traversal with simple additions
+  tlb_misses.start();
   while (s.KeepRunning()) {
     for (int i = 0; i < N * N; i++) {
       v_out[v_in[i]]++;
     }
   }
+  tlb_misses.stop();
+  reportPages(s, v_out, tlb_misses);
 }
 // Register the benchmark
-BENCHMARK(random)->DenseRange(10, 12)->Unit(benchmark::kMillisecond);
+BENCHMARK(random)->Apply(pageSizes);
 
 // Accesses in a random order but try pre-fetching
 static void randomPrefetch(benchmark::State &s) {
@@ -193,19 +219,21 @@ static void randomPrefetch(benchmark::State &s) {
   std::shuffle(begin(v_in), end(v_in), urng);
 
   // Create an output vector
-  std::vector<int> v_out(N * N);
+  HugeBuffer<int> v_out(N * N, size_t(s.range(1)) << 10);
+  auto tlb_misses = PerfCounter::dtlb_load_misses();
 
   // Profile a simple traversal with simple additions
+  tlb_misses.start();
   while (s.KeepRunning()) {
-    for (int i = 0; i < N * N; i++) {
-      // Pre-fetch an item for later
-      __builtin_prefetch(&v_out[v_in[i + 5]]);
-      v_out[v_in[i]]++;
-    }
+    // Pre-fetch an item for later (stopping before the end of v_in)
+    indirect_prefetch_loop(v_in.data(), v_out.data(), 0, v_in.size(), 5,
+                           [&](size_t i) { v_out[v_in[i]]++; });
   }
+  tlb_misses.stop();
+  reportPages(s, v_out, tlb_misses);
 }
 // Register the benchmark
-BENCHMARK(randomPrefetch)->DenseRange(10, 12)->Unit(benchmark::kMillisecond);
+BENCHMARK(randomPrefetch)->Apply(pageSizes);
 
 // Benchmark main functions
 BENCHMARK_MAIN();
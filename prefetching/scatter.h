@@ -0,0 +1,128 @@
+// Scatter updates (out[index[i]]++) for an output that's much larger than
+// the cache. Done directly, almost every update misses in the cache and
+// the TLB. Instead we:
+//   1. count how many indices fall in each bucket (a bucket is a range
+//      of the output small enough to stay in L2)
+//   2. partition the indices by bucket (one radix pass). Each bucket
+//      collects its indices in a cache-line sized staging buffer first,
+//      and full lines are written out with non-temporal stores (software
+//      write-combining), so the partition pass writes whole lines instead
+//      of scattering single elements
+//   3. apply each bucket's updates, which now only touch its L2-sized
+//      range of the output
+// By: Nick from CoffeeBeforeArch
+
+#pragma once
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// The direct loop (what prefetching.cpp's random benchmark does)
+template <typename T>
+inline void scatter_increment_direct(const int *index, size_t n, T *out) {
+  for (size_t i = 0; i < n; i++) out[index[i]]++;
+}
+
+template <typename T>
+class ScatterEngine {
+ public:
+  // Indices per staging buffer (one cache line)
+  static constexpr int line = 64 / sizeof(int);
+
+  // For outputs of out_size elements, with buckets covering bucket_bytes
+  // of the output each (pick something that fits in L2 with room to spare)
+  explicit ScatterEngine(size_t out_size, size_t bucket_bytes = 256 << 10) {
+    // Power-of-two bucket ranges, so the bucket is just index >> shift
+    size_t range = std::max<size_t>(bucket_bytes / sizeof(T), 1);
+    while ((size_t(1) << (shift + 1)) <= range) shift++;
+    num_buckets = static_cast<int>(((out_size - 1) >> shift) + 1);
+    if (out_size == 0) num_buckets = 1;
+    counts.resize(num_buckets);
+    starts.resize(num_buckets);
+    positions.resize(num_buckets);
+    fills.resize(num_buckets);
+    staging_memory.resize(size_t(num_buckets) * line + line);
+    staging = align(staging_memory.data());
+  }
+
+  int buckets() const { return num_buckets; }
+
+  // out[index[i]]++ for every i in [0, n), with 0 <= index[i] < out_size
+  void increment(const int *index, size_t n, T *out) {
+    // Everything is one bucket anyway
+    if (num_buckets == 1) {
+      scatter_increment_direct(index, n, out);
+      return;
+    }
+
+    // Count how many indices go to each bucket
+    std::fill(counts.begin(), counts.end(), 0);
+    for (size_t i = 0; i < n; i++) counts[index[i] >> shift]++;
+
+    // Where each bucket starts (on a cache line, so we stream whole lines)
+    size_t total = 0;
+    for (int b = 0; b < num_buckets; b++) {
+      starts[b] = total;
+      positions[b] = total;
+      total += (counts[b] + line - 1) / line * line;
+    }
+    if (partition_memory.size() < total + line) {
+      partition_memory.resize(total + line);
+    }
+    int *partition = align(partition_memory.data());
+
+    // Partition through the staging lines
+    std::fill(fills.begin(), fills.end(), 0);
+    for (size_t i = 0; i < n; i++) {
+      int idx = index[i];
+      int b = idx >> shift;
+      int *buffer = staging + size_t(b) * line;
+      buffer[fills[b]++] = idx;
+      if (fills[b] == line) {
+        stream_line(partition + positions[b], buffer);
+        positions[b] += line;
+        fills[b] = 0;
+      }
+    }
+
+    // Partly filled lines go out with normal stores
+    for (int b = 0; b < num_buckets; b++) {
+      std::memcpy(partition + positions[b], staging + size_t(b) * line,
+                  fills[b] * sizeof(int));
+    }
+    _mm_sfence();
+
+    // Apply one bucket at a time
+    for (int b = 0; b < num_buckets; b++) {
+      const int *begin = partition + starts[b];
+      scatter_increment_direct(begin, counts[b], out);
+    }
+  }
+
+ private:
+  static int *align(int *p) {
+    auto address = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<int *>((address + 63) & ~uintptr_t(63));
+  }
+
+  // Write one full cache line, bypassing the cache
+  static void stream_line(int *dst, const int *src) {
+    auto d = reinterpret_cast<__m128i *>(dst);
+    auto s = reinterpret_cast<const __m128i *>(src);
+    for (int i = 0; i < 4; i++) _mm_stream_si128(d + i, _mm_load_si128(s + i));
+  }
+
+  int shift = 0;
+  int num_buckets = 1;
+  std::vector<size_t> counts;
+  std::vector<size_t> starts;
+  std::vector<size_t> positions;
+  std::vector<int> fills;
+  std::vector<int> staging_memory;
+  int *staging = nullptr;
+  std::vector<int> partition_memory;
+};
@@ -0,0 +1,67 @@
+// This program compares the direct scatter loop (v_out[v_in[i]]++ over
+// shuffled indices, like random in prefetching.cpp) with the
+// radix-partitioned scatter engine, for a few bucket sizes
+// Build: g++ -O3 -march=native scatter_bench.cpp -lbenchmark -lpthread
+// By: Nick from CoffeeBeforeArch
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "scatter.h"
+
+// Shuffled indices 0..n-1
+static std::vector<int> randomIndices(int n) {
+  std::vector<int> v_in(n);
+  std::iota(begin(v_in), end(v_in), 0);
+  std::mt19937 urng(42);
+  std::shuffle(begin(v_in), end(v_in), urng);
+  return v_in;
+}
+
+// The direct loop
+static void direct(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    scatter_increment_direct(v_in.data(), v_in.size(), v_out.data());
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+}
+BENCHMARK(direct)->DenseRange(10, 13)->Unit(benchmark::kMillisecond);
+
+// Partition first, with buckets of the second argument's KB of output
+static void engine(benchmark::State &s) {
+  // Input/output vector size
+  int N = 1 << s.range(0);
+  const size_t bucket_bytes = size_t(s.range(1)) << 10;
+
+  auto v_in = randomIndices(N * N);
+  std::vector<int> v_out(N * N);
+  ScatterEngine<int> scatter(v_out.size(), bucket_bytes);
+
+  // Make sure we get the same answer as the direct loop
+  std::vector<int> expected(N * N);
+  scatter_increment_direct(v_in.data(), v_in.size(), expected.data());
+  scatter.increment(v_in.data(), v_in.size(), v_out.data());
+  if (v_out != expected) s.SkipWithError("Incorrect result");
+
+  // Profile a simple traversal with simple additions
+  while (s.KeepRunning()) {
+    scatter.increment(v_in.data(), v_in.size(), v_out.data());
+  }
+  s.SetItemsProcessed(int64_t(N) * N * s.iterations());
+  s.counters["buckets"] = scatter.buckets();
+}
+BENCHMARK(engine)
+    ->ArgsProduct({benchmark::CreateDenseRange(10, 13, 1), {64, 256, 1024}})
+    ->Unit(benchmark::kMillisecond);
+
+// Benchmark main functions
+BENCHMARK_MAIN();